@@ -0,0 +1,341 @@
+/**
+ * @file batch.c
+ * @brief Batch job mode for the cipher command-line interface.
+ *
+ * This file contains a cache of prepared cipher contexts and the loop that runs
+ * many (operation, key, message) jobs read from a single input stream, so that
+ * short messages do not each pay for a process start and a key validation.
+ *
+ * @author
+ * Oliver Dean 21307131
+ *
+ * @bug No known bugs.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <sys/types.h>
+#include "crypto.h"
+#include "cli.h"
+
+/** Number of distinct keys a batch run keeps prepared at once. */
+#define BATCH_CACHE_CAPACITY 4096
+
+/** Longest error message kept for an invalid cached key. */
+#define KEY_CACHE_ERROR_SIZE 160
+
+/**
+ * @brief One slot of a key cache.
+ */
+typedef struct {
+    char *operation;        // NULL when the slot is empty
+    char *key_text;
+    size_t hash;
+    int valid;              // non-zero if ctx is initialised
+    cipher_ctx ctx;
+    char error[KEY_CACHE_ERROR_SIZE];
+} key_cache_entry;
+
+struct key_cache {
+    size_t capacity;
+    key_cache_entry *entries;
+};
+
+/**
+ * @brief Hashes an (operation, key) pair with 64-bit FNV-1a.
+ *
+ * @param operation The operation name.
+ * @param key_text The key text.
+ * @return The hash.
+ */
+static size_t key_cache_hash(const char *operation, const char *key_text) {
+    unsigned long long hash = 14695981039346656037ULL;
+    for (const char *p = operation; *p != '\0'; p++) {
+        hash = (hash ^ (unsigned char)*p) * 1099511628211ULL;
+    }
+    hash = (hash ^ 0xFF) * 1099511628211ULL;    // separator that cannot occur in either string
+    for (const char *p = key_text; *p != '\0'; p++) {
+        hash = (hash ^ (unsigned char)*p) * 1099511628211ULL;
+    }
+    return (size_t)hash;
+}
+
+/**
+ * @brief Empties a cache slot, wiping the key it held.
+ *
+ * @param entry The slot to empty.
+ */
+static void key_cache_evict(key_cache_entry *entry) {
+    if (entry->operation == NULL) {
+        return;
+    }
+    if (entry->valid) {
+        cipher_final(&entry->ctx);
+    }
+    volatile char *p = entry->key_text;
+    while (*p != '\0') {
+        *p++ = 0;
+    }
+    free(entry->key_text);
+    free(entry->operation);
+    entry->operation = NULL;
+    entry->key_text = NULL;
+    entry->valid = 0;
+}
+
+/**
+ * @brief Creates a key cache.
+ *
+ * @param capacity The number of slots.
+ * @return The new cache, or NULL if memory could not be allocated.
+ */
+key_cache *key_cache_new(size_t capacity) {
+    assert(capacity > 0);
+    key_cache *cache = malloc(sizeof(*cache));
+    if (cache == NULL) {
+        return NULL;
+    }
+    cache->capacity = capacity;
+    cache->entries = calloc(capacity, sizeof(*cache->entries));
+    if (cache->entries == NULL) {
+        free(cache);
+        return NULL;
+    }
+    return cache;
+}
+
+/**
+ * @brief Returns the prepared context for an (operation, key) pair.
+ *
+ * @param cache The cache.
+ * @param operation The operation name.
+ * @param key_text The key text.
+ * @param error Receives a description of the problem if the pair is invalid.
+ * @return The context, rewound to the start of a message, or NULL if the pair is invalid.
+ *
+ * On a miss the pair is validated and prepared by prepare_cipher and stored in its
+ * slot, replacing whatever was there.
+ */
+cipher_ctx *key_cache_get(key_cache *cache, const char *operation, const char *key_text, const char **error) {
+    assert(cache != NULL && operation != NULL && key_text != NULL && error != NULL);
+    size_t hash = key_cache_hash(operation, key_text);
+    key_cache_entry *entry = &cache->entries[hash % cache->capacity];
+
+    if (entry->operation == NULL || entry->hash != hash
+            || strcmp(entry->operation, operation) != 0 || strcmp(entry->key_text, key_text) != 0) {
+        key_cache_evict(entry);
+        size_t operation_len = strlen(operation) + 1;
+        size_t key_len = strlen(key_text) + 1;
+        entry->operation = malloc(operation_len);
+        entry->key_text = malloc(key_len);
+        if (entry->operation == NULL || entry->key_text == NULL) {
+            free(entry->operation);
+            free(entry->key_text);
+            entry->operation = NULL;
+            entry->key_text = NULL;
+            *error = "Memory allocation failed.";
+            return NULL;
+        }
+        memcpy(entry->operation, operation, operation_len);
+        memcpy(entry->key_text, key_text, key_len);
+        entry->hash = hash;
+        entry->valid = prepare_cipher(operation, key_text, &entry->ctx, entry->error, sizeof(entry->error)) == 0;
+    }
+
+    if (!entry->valid) {
+        *error = entry->error;
+        return NULL;
+    }
+    cipher_reset(&entry->ctx);
+    return &entry->ctx;
+}
+
+/**
+ * @brief Frees a key cache.
+ *
+ * @param cache The cache, or NULL.
+ */
+void key_cache_free(key_cache *cache) {
+    if (cache == NULL) {
+        return;
+    }
+    for (size_t i = 0; i < cache->capacity; i++) {
+        key_cache_evict(&cache->entries[i]);
+    }
+    free(cache->entries);
+    free(cache);
+}
+
+/**
+ * @brief Splits a job header into its space-separated fields, in place.
+ *
+ * @param line The header, without its newline.
+ * @param operation Receives the first field.
+ * @param key_text Receives the second field.
+ * @param rest Receives everything after the second space (empty if there is none).
+ * @return 0 on success, 1 if the line has no space after the operation.
+ */
+static int split_job(char *line, char **operation, char **key_text, char **rest) {
+    char *space = strchr(line, ' ');
+    if (space == NULL) {
+        return 1;
+    }
+    *space = '\0';
+    *operation = line;
+    *key_text = space + 1;
+
+    space = strchr(*key_text, ' ');
+    if (space == NULL) {
+        *rest = *key_text + strlen(*key_text);
+    } else {
+        *space = '\0';
+        *rest = space + 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Parses a non-negative decimal message length.
+ *
+ * @param text The text to parse.
+ * @param length Receives the value.
+ * @return 0 on success, 1 if the text is not a plain decimal number.
+ */
+static int parse_length(const char *text, size_t *length) {
+    if (*text < '0' || *text > '9') {
+        return 1;
+    }
+    char *end;
+    errno = 0;
+    unsigned long long value = strtoull(text, &end, 10);
+    if (errno != 0 || *end != '\0' || value > (size_t)-1) {
+        return 1;
+    }
+    *length = (size_t)value;
+    return 0;
+}
+
+/**
+ * @brief Runs one newline-delimited job.
+ *
+ * @param cache The key cache.
+ * @param line The job line, without its newline; transformed in place.
+ * @param len The length of the line.
+ * @param out The stream to write the result line to.
+ * @param error Receives a description of the problem if the job fails.
+ * @return 0 on success, 1 on failure (an empty line is written instead).
+ */
+static int run_line_job(key_cache *cache, char *line, size_t len, FILE *out, const char **error) {
+    char *operation, *key_text, *message;
+    cipher_ctx *ctx = NULL;
+    if (split_job(line, &operation, &key_text, &message) != 0) {
+        *error = "Expected '<operation> <key> <message>'.";
+    } else {
+        ctx = key_cache_get(cache, operation, key_text, error);
+    }
+    if (ctx == NULL) {
+        fputc('\n', out);
+        return 1;
+    }
+    size_t message_len = len - (size_t)(message - line);
+    cipher_update(ctx, message, message, message_len);
+    fwrite(message, 1, message_len, out);
+    fputc('\n', out);
+    return 0;
+}
+
+/**
+ * @brief Runs every job from an input stream.
+ *
+ * @param in The stream of job records.
+ * @param out The stream to write results to.
+ * @param format BATCH_LINES or BATCH_LENGTH.
+ * @return 0 if every job succeeded, 1 otherwise.
+ *
+ * The header line buffer and the message buffer are reused across jobs, so memory use
+ * is bounded by the largest single job plus the key cache.
+ */
+int run_batch(FILE *in, FILE *out, batch_format format) {
+    key_cache *cache = key_cache_new(BATCH_CACHE_CAPACITY);
+    if (cache == NULL) {
+        fprintf(stderr, "Memory allocation failed.\n");
+        return 1;
+    }
+
+    char *line = NULL;
+    size_t line_cap = 0;
+    char *message = NULL;
+    size_t message_cap = 0;
+    size_t job = 0;
+    int status = 0;
+    ssize_t n;
+
+    while ((n = getline(&line, &line_cap, in)) > 0) {
+        size_t len = (size_t)n;
+        const char *error = NULL;
+        job++;
+        if (line[len - 1] == '\n') {
+            line[--len] = '\0';
+        }
+
+        if (format == BATCH_LINES) {
+            if (run_line_job(cache, line, len, out, &error) != 0) {
+                fprintf(stderr, "Job %zu: %s\n", job, error);
+                status = 1;
+            }
+            continue;
+        }
+
+        char *operation, *key_text, *length_text;
+        size_t message_len;
+        if (split_job(line, &operation, &key_text, &length_text) != 0
+                || parse_length(length_text, &message_len) != 0) {
+            fprintf(stderr, "Job %zu: Expected '<operation> <key> <length>'.\n", job);
+            status = 1;
+            break;      // without a length the rest of the stream cannot be framed
+        }
+        if (message_len > message_cap) {
+            char *grown = realloc(message, message_len);
+            if (grown == NULL) {
+                fprintf(stderr, "Job %zu: Memory allocation failed.\n", job);
+                status = 1;
+                break;
+            }
+            message = grown;
+            message_cap = message_len;
+        }
+        if (fread(message, 1, message_len, in) != message_len) {
+            fprintf(stderr, "Job %zu: Input ended inside the message.\n", job);
+            status = 1;
+            break;
+        }
+
+        cipher_ctx *ctx = key_cache_get(cache, operation, key_text, &error);
+        if (ctx == NULL) {
+            fprintf(out, "ERR %zu\n%s", strlen(error), error);
+            status = 1;
+            continue;
+        }
+        cipher_update(ctx, message, message, message_len);
+        fprintf(out, "OK %zu\n", message_len);
+        fwrite(message, 1, message_len, out);
+    }
+
+    if (ferror(in)) {
+        perror("Failed to read input");
+        status = 1;
+    }
+    if (fflush(out) != 0) {
+        perror("Failed to write output");
+        status = 1;
+    }
+    free(line);
+    free(message);
+    key_cache_free(cache);
+    return status;
+}
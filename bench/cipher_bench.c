@@ -0,0 +1,276 @@
+/**
+ * @file cipher_bench.c
+ * @brief Throughput benchmark for the Caesar and Vigenere cipher functions.
+ *
+ * Measures caesar_encrypt, caesar_decrypt, vigenere_encrypt and vigenere_decrypt while
+ * sweeping one parameter at a time around a baseline: input size (16 B up to the
+ * maximum), the fraction of characters that fall in the cipher's range, the Vigenere
+ * key length, and the width of the character range. Results are written to standard
+ * output as JSON, one object per measurement, so runs can be compared when kernels change.
+ *
+ * Usage: cipher_bench [--max-size BYTES] [--kernel NAME] [--min-time SECONDS]
+ *
+ * @author
+ * Oliver Dean 21307131
+ *
+ * @bug No known bugs.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../crypto.h"
+
+/** Baseline parameters; each sweep varies one of these. */
+#define BASE_SIZE (1024 * 1024)
+#define BASE_DENSITY 0.75
+#define BASE_KEY_LENGTH 10
+#define BASE_RANGE_WIDTH 26
+
+/** Every measurement runs at least this many repetitions. */
+#define MIN_REPETITIONS 3
+
+/** Each timed repetition processes at least this many bytes, calling repeatedly if needed. */
+#define BATCH_BYTES (64 * 1024)
+
+/**
+ * @brief A character range to benchmark. Ranges never include the null character, so
+ * generated text is always a valid C string.
+ */
+typedef struct {
+    char low;
+    char high;
+} bench_range;
+
+/**
+ * @brief Returns the range of a given width used by the benchmark.
+ *
+ * @param width 26, 95, 127 or 200.
+ * @return The range: 'A'-'Z', the printable ASCII characters, every positive char, or a
+ *         200-character range that spans negative char values (too wide for the vector
+ *         kernels).
+ */
+static bench_range range_of_width(int width) {
+    switch (width) {
+    case 95:
+        return (bench_range){ ' ', '~' };
+    case 127:
+        return (bench_range){ 1, 127 };
+    case 200:
+        return (bench_range){ -100, 99 };
+    default:
+        return (bench_range){ 'A', 'Z' };
+    }
+}
+
+/**
+ * @brief Returns a pseudo-random number; a fixed xorshift generator keeps runs repeatable.
+ */
+static unsigned next_random(void) {
+    static unsigned long long state = 0x9E3779B97F4A7C15ULL;
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return (unsigned)(state >> 32);
+}
+
+/**
+ * @brief Fills a buffer with a null-terminated test text.
+ *
+ * @param text The buffer, of size + 1 bytes.
+ * @param size The number of characters.
+ * @param range The cipher range.
+ * @param density The fraction of characters that should fall within the range.
+ *
+ * Out-of-range characters are drawn from the non-null bytes outside the range.
+ */
+static void fill_text(char *text, size_t size, bench_range range, double density) {
+    char outside[256];
+    int outside_count = 0;
+    for (int c = -128; c < 128; c++) {
+        if (c != 0 && (c < range.low || c > range.high)) {
+            outside[outside_count++] = (char)c;
+        }
+    }
+    int width = range.high - range.low + 1;
+    unsigned threshold = (unsigned)(density * 65536);
+    for (size_t i = 0; i < size; i++) {
+        if ((next_random() & 0xFFFF) < threshold || outside_count == 0) {
+            char c;
+            do {
+                c = (char)(range.low + (int)(next_random() % (unsigned)width));
+            } while (c == 0);
+            text[i] = c;
+        } else {
+            text[i] = outside[next_random() % (unsigned)outside_count];
+        }
+    }
+    text[size] = '\0';
+}
+
+/**
+ * @brief Returns a monotonic timestamp in seconds.
+ */
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/** The functions under test. */
+enum { CAESAR_ENCRYPT, CAESAR_DECRYPT, VIGENERE_ENCRYPT, VIGENERE_DECRYPT, FUNCTION_COUNT };
+
+static const char *function_names[FUNCTION_COUNT] = {
+    "caesar_encrypt", "caesar_decrypt", "vigenere_encrypt", "vigenere_decrypt"
+};
+
+/** Whether a result object has been printed yet, for comma placement. */
+static int printed_any = 0;
+
+/**
+ * @brief Measures one function for one set of parameters and prints a JSON result.
+ *
+ * @param function The function to run.
+ * @param text The input text, of at least `size` characters.
+ * @param output A buffer of at least size + 1 bytes.
+ * @param size The input size.
+ * @param range_width The width of the cipher range.
+ * @param density The in-range fraction the text was generated with.
+ * @param key_length The Vigenere key length (ignored for Caesar).
+ * @param min_time Keep repeating until at least this many seconds have been measured.
+ *
+ * Small inputs are run many times per timed repetition so the timer overhead does not
+ * dominate. The reported rate is that of the fastest repetition, which is the least
+ * disturbed by other activity on the machine.
+ */
+static void measure(int function, char *text, char *output, size_t size, int range_width,
+                    double density, int key_length, double min_time) {
+    bench_range range = range_of_width(range_width);
+    char key[1024];
+    for (int i = 0; i < key_length; i++) {
+        do {
+            key[i] = (char)(range.low + (int)(next_random() % (unsigned)range_width));
+        } while (key[i] == 0);
+    }
+    key[key_length] = '\0';
+    int caesar_key = range_width / 3;
+
+    char saved = text[size];
+    text[size] = '\0';
+    long calls = size < BATCH_BYTES ? (long)(BATCH_BYTES / size) : 1;
+    double best = 1e30, total = 0;
+    long repetitions = 0;
+    while (repetitions < MIN_REPETITIONS || total < min_time) {
+        double start = now_seconds();
+        for (long call = 0; call < calls; call++) {
+            switch (function) {
+            case CAESAR_ENCRYPT:
+                caesar_encrypt(range.low, range.high, caesar_key, text, output);
+                break;
+            case CAESAR_DECRYPT:
+                caesar_decrypt(range.low, range.high, caesar_key, text, output);
+                break;
+            case VIGENERE_ENCRYPT:
+                vigenere_encrypt(range.low, range.high, key, text, output);
+                break;
+            default:
+                vigenere_decrypt(range.low, range.high, key, text, output);
+                break;
+            }
+        }
+        double elapsed = now_seconds() - start;
+        total += elapsed;
+        if (elapsed / calls < best) {
+            best = elapsed / calls;
+        }
+        repetitions++;
+    }
+    text[size] = saved;
+
+    if (best <= 0) {
+        best = 1e-9;    // below timer resolution
+    }
+    printf("%s    {\"function\": \"%s\", \"bytes\": %zu, \"density\": %.2f, \"key_length\": %d, "
+           "\"range_width\": %d, \"repetitions\": %ld, \"mb_per_s\": %.1f, \"ns_per_byte\": %.4f}",
+           printed_any ? ",\n" : "", function_names[function], size, density,
+           function >= VIGENERE_ENCRYPT ? key_length : 1, range_width, repetitions,
+           size / best / 1e6, best * 1e9 / size);
+    printed_any = 1;
+    fflush(stdout);
+}
+
+int main(int argc, char **argv) {
+    size_t max_size = (size_t)1 << 30;
+    double min_time = 0.2;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--max-size") == 0 && i + 1 < argc) {
+            max_size = (size_t)strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--kernel") == 0 && i + 1 < argc) {
+            if (crypto_set_kernel(argv[++i]) != 0) {
+                fprintf(stderr, "Kernel '%s' is unknown or not supported here.\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--min-time") == 0 && i + 1 < argc) {
+            min_time = atof(argv[++i]);
+        } else {
+            fprintf(stderr, "Usage: %s [--max-size BYTES] [--kernel NAME] [--min-time SECONDS]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (max_size < BASE_SIZE) {
+        max_size = BASE_SIZE;
+    }
+
+    char *text = malloc(max_size + 1);
+    char *output = malloc(max_size + 1);
+    if (text == NULL || output == NULL) {
+        fprintf(stderr, "Failed to allocate %zu-byte buffers.\n", max_size);
+        return 1;
+    }
+
+    printf("{\n  \"kernel\": \"%s\",\n  \"results\": [\n", crypto_kernel_name());
+
+    // Input size, at the baseline density and range.
+    fill_text(text, max_size, range_of_width(BASE_RANGE_WIDTH), BASE_DENSITY);
+    for (size_t size = 16; size <= max_size; size *= 4) {
+        for (int f = 0; f < FUNCTION_COUNT; f++) {
+            measure(f, text, output, size, BASE_RANGE_WIDTH, BASE_DENSITY, BASE_KEY_LENGTH, min_time);
+        }
+    }
+
+    // In-range density.
+    static const double densities[] = { 0.0, 0.25, 0.5, 0.9, 1.0 };
+    for (size_t d = 0; d < sizeof(densities) / sizeof(densities[0]); d++) {
+        fill_text(text, BASE_SIZE, range_of_width(BASE_RANGE_WIDTH), densities[d]);
+        for (int f = 0; f < FUNCTION_COUNT; f++) {
+            measure(f, text, output, BASE_SIZE, BASE_RANGE_WIDTH, densities[d], BASE_KEY_LENGTH, min_time);
+        }
+    }
+
+    // Vigenere key length.
+    static const int key_lengths[] = { 1, 3, 16, 64, 256, 1000 };
+    fill_text(text, BASE_SIZE, range_of_width(BASE_RANGE_WIDTH), BASE_DENSITY);
+    for (size_t k = 0; k < sizeof(key_lengths) / sizeof(key_lengths[0]); k++) {
+        for (int f = VIGENERE_ENCRYPT; f < FUNCTION_COUNT; f++) {
+            measure(f, text, output, BASE_SIZE, BASE_RANGE_WIDTH, BASE_DENSITY, key_lengths[k], min_time);
+        }
+    }
+
+    // Range width.
+    static const int widths[] = { 26, 95, 127, 200 };
+    for (size_t w = 0; w < sizeof(widths) / sizeof(widths[0]); w++) {
+        fill_text(text, BASE_SIZE, range_of_width(widths[w]), BASE_DENSITY);
+        for (int f = 0; f < FUNCTION_COUNT; f++) {
+            measure(f, text, output, BASE_SIZE, widths[w], BASE_DENSITY, BASE_KEY_LENGTH, min_time);
+        }
+    }
+
+    printf("\n  ]\n}\n");
+    free(text);
+    free(output);
+    return 0;
+}
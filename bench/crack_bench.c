@@ -0,0 +1,294 @@
+/**
+ * @file crack_bench.c
+ * @brief Time-to-crack benchmark for the Caesar and Vigenere crackers.
+ *
+ * Builds plaintexts of increasing length from a sample text, encrypts each with a known
+ * key, and runs crack_caesar_cipher and find_best_key_brute_force on the result as
+ * library calls, along with the period-estimating find_best_key_columns. For every
+ * (cracker, text length, key length) it records the wall time, the number of candidate
+ * keys evaluated and whether the right key was recovered, and writes the results to
+ * standard output as JSON.
+ *
+ * The Vigenere brute force grows as 26^key_length, so each of its searches is given a
+ * candidate budget; a search that runs out reports budget_exhausted instead of running
+ * for days. Candidates are scored from column histograms, so their cost does not grow
+ * with the text; the time that does is the single pass that builds the histograms.
+ *
+ * Usage: crack_bench [--text FILE] [--max-length BYTES] [--max-vigenere-length BYTES]
+ *                    [--budget CANDIDATES] [--min-time SECONDS] [--threads N] [--prune]
+ *
+ * Caesar and column-solver lengths run up to --max-length (default 1 MiB) and Vigenere
+ * brute-force lengths up to --max-vigenere-length (default 1 MiB). --min-time applies to
+ * the Caesar cracks, which are repeated and averaged; the default sample text path is
+ * relative to the repository root, where `make bench-crack` runs. --threads runs the
+ * Vigenere brute force with find_best_key_brute_force_parallel (default 1), and --prune
+ * lets it skip key prefixes that cannot win; "scored" and "nodes_pruned" show how many
+ * of the candidates searched were actually scored.
+ *
+ * @author
+ * Oliver Dean 21307131
+ *
+ * @bug No known bugs.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include "../crypto.h"
+#include "../caesar_crack/caesar_crack.h"
+#include "../vin_crack/vigenere_crack.h"
+
+/** The shortest ciphertext measured; lengths grow by a factor of 4 from here. */
+#define MIN_TEXT_LENGTH 64
+
+/**
+ * @brief Returns a pseudo-random number; a fixed xorshift generator keeps runs repeatable.
+ */
+static unsigned next_random(void) {
+    static unsigned long long state = 0x9E3779B97F4A7C15ULL;
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return (unsigned)(state >> 32);
+}
+
+/**
+ * @brief Returns a monotonic timestamp in seconds.
+ */
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * @brief Reads a whole file into a null-terminated buffer.
+ *
+ * @param path The file to read.
+ * @param length Receives the number of bytes read.
+ * @return The contents, or NULL on error (a message has been printed).
+ */
+static char *read_sample(const char *path, size_t *length) {
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        perror("Failed to open sample text");
+        return NULL;
+    }
+    size_t cap = 4096, len = 0;
+    char *text = malloc(cap);
+    size_t n;
+    while (text != NULL && (n = fread(text + len, 1, cap - len - 1, file)) > 0) {
+        len += n;
+        if (cap - len - 1 == 0) {
+            char *grown = realloc(text, cap * 2);
+            if (grown == NULL) {
+                free(text);
+            }
+            text = grown;
+            cap *= 2;
+        }
+    }
+    fclose(file);
+    if (text == NULL || len == 0) {
+        fprintf(stderr, "Sample text '%s' is empty or could not be read.\n", path);
+        free(text);
+        return NULL;
+    }
+    text[len] = '\0';
+    *length = len;
+    return text;
+}
+
+/**
+ * @brief Fills a buffer with the sample text, repeated or truncated to `length` bytes.
+ *
+ * @param text The buffer, of length + 1 bytes.
+ * @param length The number of characters.
+ * @param sample The sample text.
+ * @param sample_len Its length.
+ * @param upper Non-zero to convert letters to upper case (the Vigenere cracker's key
+ *              runs over both cases, while vigenere_encrypt works on one range).
+ */
+static void fill_plain_text(char *text, size_t length, const char *sample, size_t sample_len, int upper) {
+    for (size_t i = 0; i < length; i++) {
+        char c = sample[i % sample_len];
+        text[i] = upper ? (char)toupper((unsigned char)c) : c;
+    }
+    text[length] = '\0';
+}
+
+/** Whether a result object has been printed yet, for comma placement. */
+static int printed_any = 0;
+
+/**
+ * @brief Prints one measurement as a JSON object.
+ */
+static void print_result(const char *cracker, size_t text_length, int key_length, const char *key,
+                         const char *found_key, double seconds, size_t candidates, size_t scored,
+                         size_t nodes_pruned, int recovered, int budget_exhausted) {
+    printf("%s    {\"cracker\": \"%s\", \"text_length\": %zu, \"key_length\": %d, \"key\": \"%s\", "
+           "\"found_key\": \"%s\", \"seconds\": %.6f, \"candidates\": %zu, \"candidates_per_sec\": %.0f, "
+           "\"scored\": %zu, \"nodes_pruned\": %zu, \"key_recovered\": %s, \"budget_exhausted\": %s}",
+           printed_any ? ",\n" : "", cracker, text_length, key_length, key, found_key, seconds,
+           candidates, seconds > 0 ? candidates / seconds : 0.0, scored, nodes_pruned,
+           recovered ? "true" : "false", budget_exhausted ? "true" : "false");
+    printed_any = 1;
+    fflush(stdout);
+}
+
+/**
+ * @brief Cracks a Caesar ciphertext of the given length and prints the result.
+ *
+ * @param plain_text A buffer of length + 1 bytes for the plaintext.
+ * @param cipher_text A buffer of length + 1 bytes for the ciphertext.
+ * @param length The text length.
+ * @param sample The sample text and its length.
+ * @param min_time Repeat the crack until this many seconds have passed and report the mean.
+ */
+static void bench_caesar(char *plain_text, char *cipher_text, size_t length, const char *sample,
+                         size_t sample_len, double min_time) {
+    int key = 1 + (int)(next_random() % 25);
+    fill_plain_text(plain_text, length, sample, sample_len, 0);
+    caesar_encrypt('A', 'Z', key, plain_text, cipher_text);
+    caesar_encrypt('a', 'z', key, cipher_text, cipher_text);
+
+    caesar_crack_result result;
+    long runs = 0;
+    double start = now_seconds(), elapsed;
+    do {
+        crack_caesar_cipher(cipher_text, &result);
+        runs++;
+        elapsed = now_seconds() - start;
+    } while (elapsed < min_time);
+
+    char key_text[8], found_text[8];
+    snprintf(key_text, sizeof(key_text), "%d", key);
+    snprintf(found_text, sizeof(found_text), "%d", result.key);
+    print_result("caesar", length, 1, key_text, found_text, elapsed / runs, result.candidates,
+                 result.candidates, 0, result.key == key, 0);
+}
+
+/**
+ * @brief Cracks a Vigenere ciphertext of the given length and key length and prints the result.
+ *
+ * @param plain_text A buffer of length + 1 bytes for the plaintext.
+ * @param cipher_text A buffer of length + 1 bytes for the ciphertext.
+ * @param cracked A buffer of length + 1 bytes for the cracker's plaintext.
+ * @param length The text length.
+ * @param key_length The key length.
+ * @param sample The sample text and its length.
+ * @param budget The candidate budget for each search; 0 for none.
+ * @param brute_force Non-zero to use find_best_key_brute_force, zero for find_best_key_columns.
+ * @param threads The number of threads for the brute force.
+ * @param prune Non-zero to prune the brute force.
+ *
+ * The search runs once, since a brute-force search that uses its whole budget already
+ * takes long enough to time. The key counts as recovered when
+ * the cracker's plaintext matches the original, which also accepts a shorter key that
+ * repeats to the same one (for example "AB" for "ABAB").
+ */
+static void bench_vigenere(char *plain_text, char *cipher_text, char *cracked, size_t length,
+                           int key_length, const char *sample, size_t sample_len, size_t budget,
+                           int brute_force, int threads, int prune) {
+    char key[MAX_KEY_LENGTH + 1];
+    for (int i = 0; i < key_length; i++) {
+        key[i] = (char)('A' + next_random() % 26);
+    }
+    key[key_length] = '\0';
+    fill_plain_text(plain_text, length, sample, sample_len, 1);
+    vigenere_encrypt('A', 'Z', key, plain_text, cipher_text);
+
+    char found_key[MAX_KEY_LENGTH + 1] = {0};
+    vigenere_crack_stats stats = { .max_candidates = budget, .prune = prune != 0 };
+    double start = now_seconds();
+    if (brute_force) {
+        find_best_key_brute_force_parallel(cipher_text, found_key, cracked, &stats, threads);
+    } else {
+        find_best_key_columns(cipher_text, MAX_KEY_LENGTH, found_key, cracked, &stats);
+    }
+    double elapsed = now_seconds() - start;
+
+    print_result(brute_force ? "vigenere" : "vigenere_columns", length, key_length, key, found_key, elapsed, stats.candidates,
+                 brute_force ? stats.scored : stats.candidates, stats.nodes_pruned, strcmp(cracked, plain_text) == 0,
+                 stats.budget_exhausted);
+}
+
+int main(int argc, char **argv) {
+    const char *sample_path = "caesar_crack/cat_story.txt";
+    size_t max_length = 1 << 20;
+    size_t max_vigenere_length = 1 << 20;
+    size_t budget = 5000;
+    double min_time = 0.1;
+    int threads = 1;
+    int prune = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--text") == 0 && i + 1 < argc) {
+            sample_path = argv[++i];
+        } else if (strcmp(argv[i], "--max-length") == 0 && i + 1 < argc) {
+            max_length = (size_t)strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--max-vigenere-length") == 0 && i + 1 < argc) {
+            max_vigenere_length = (size_t)strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--budget") == 0 && i + 1 < argc) {
+            budget = (size_t)strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--min-time") == 0 && i + 1 < argc) {
+            min_time = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+            threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--prune") == 0) {
+            prune = 1;
+        } else {
+            fprintf(stderr, "Usage: %s [--text FILE] [--max-length BYTES] [--max-vigenere-length BYTES] "
+                    "[--budget CANDIDATES] [--min-time SECONDS] [--threads N] [--prune]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (max_vigenere_length > max_length) {
+        max_length = max_vigenere_length;
+    }
+
+    size_t sample_len;
+    char *sample = read_sample(sample_path, &sample_len);
+    char *plain_text = malloc(max_length + 1);
+    char *cipher_text = malloc(max_length + 1);
+    char *cracked = malloc(max_length + 1);
+    if (sample == NULL || plain_text == NULL || cipher_text == NULL || cracked == NULL) {
+        if (sample != NULL) {
+            fprintf(stderr, "Failed to allocate %zu-byte buffers.\n", max_length);
+        }
+        free(sample);
+        free(plain_text);
+        free(cipher_text);
+        free(cracked);
+        return 1;
+    }
+
+    printf("{\n  \"budget\": %zu,\n  \"threads\": %d,\n  \"prune\": %s,\n  \"results\": [\n", budget, threads,
+           prune ? "true" : "false");
+    for (size_t length = MIN_TEXT_LENGTH; length <= max_length; length *= 4) {
+        bench_caesar(plain_text, cipher_text, length, sample, sample_len, min_time);
+    }
+    for (size_t length = MIN_TEXT_LENGTH; length <= max_vigenere_length; length *= 4) {
+        for (int key_length = 1; key_length <= MAX_KEY_LENGTH; key_length++) {
+            bench_vigenere(plain_text, cipher_text, cracked, length, key_length, sample, sample_len,
+                           budget, 1, threads, prune);
+        }
+    }
+    for (size_t length = MIN_TEXT_LENGTH; length <= max_length; length *= 4) {
+        for (int key_length = 1; key_length <= MAX_KEY_LENGTH; key_length++) {
+            bench_vigenere(plain_text, cipher_text, cracked, length, key_length, sample, sample_len,
+                           0, 0, 1, 0);
+        }
+    }
+    printf("\n  ]\n}\n");
+
+    free(sample);
+    free(plain_text);
+    free(cipher_text);
+    free(cracked);
+    return 0;
+}
@@ -0,0 +1,290 @@
+/**
+ * @file serve_bench.c
+ * @brief Loopback load generator for the `crypto_1 --serve` daemon.
+ *
+ * Opens a number of client connections to a running server, keeps a fixed number of
+ * requests in flight on each, and reports throughput and latency percentiles as one
+ * line of JSON. With --check it instead sends one fixed pipelined batch of requests
+ * and verifies every response byte, for `make test`.
+ *
+ * Usage: serve_bench <socket> [clients] [requests per client] [pipeline depth] [message bytes]
+ *        serve_bench --check <socket>
+ *
+ * @author
+ * Oliver Dean 21307131
+ *
+ * @bug No known bugs.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+/**
+ * @brief Settings and results for one client thread.
+ */
+typedef struct {
+    const char *socket_path;
+    int requests;
+    int depth;
+    size_t message_len;
+    double *latencies;      // one per request, in microseconds
+    int failures;
+} bench_client;
+
+/**
+ * @brief Returns a monotonic timestamp in microseconds.
+ */
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+/**
+ * @brief Writes or reads exactly `len` bytes.
+ *
+ * @param fd The socket.
+ * @param buffer The data.
+ * @param len The number of bytes.
+ * @param writing Non-zero to write, zero to read.
+ * @return 0 on success, -1 on error or end of stream.
+ */
+static int transfer_all(int fd, char *buffer, size_t len, int writing) {
+    while (len > 0) {
+        ssize_t n = writing ? write(fd, buffer, len) : read(fd, buffer, len);
+        if (n <= 0) {
+            return -1;
+        }
+        buffer += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+/**
+ * @brief Connects to the server.
+ *
+ * @param socket_path The server's socket.
+ * @return The connected socket, or -1 on error.
+ */
+static int connect_server(const char *socket_path) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, socket_path, sizeof(addr.sun_path) - 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        perror("Failed to connect");
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/** A request of the --check round trip and the response it must get. */
+typedef struct {
+    const char *payload;
+    size_t payload_len;
+    const char *response;
+    size_t response_len;
+} check_case;
+
+/**
+ * @brief Sends every check case on one connection before reading any response, and compares the responses.
+ *
+ * @param socket_path The server's socket.
+ * @return 0 if every response matched, 1 otherwise.
+ *
+ * The cases cover a Caesar and a Vigenere request, a message with a NUL byte in it, and
+ * an invalid key, whose error response must not disturb the requests after it.
+ */
+static int check_server(const char *socket_path) {
+    static const char error[] = "\1Key 99 is out of valid range [0, 25]";
+    static const check_case cases[] = {
+        { "caesar-encrypt 5\nHELLO", 22, "\0MJQQT", 6 },
+        { "vigenere-encrypt KEY\nA\0BC", 25, "\0K\0FA", 5 },
+        { "caesar-encrypt 99\nHI", 20, error, sizeof(error) - 1 },
+        { "vigenere-decrypt KEY\nKFA", 24, "\0ABC", 4 },
+    };
+    size_t count = sizeof(cases) / sizeof(cases[0]);
+    int fd = connect_server(socket_path);
+    if (fd < 0) {
+        return 1;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        size_t len = cases[i].payload_len;
+        char length[4] = { (char)(len >> 24), (char)(len >> 16), (char)(len >> 8), (char)len };
+        if (transfer_all(fd, length, 4, 1) != 0 || transfer_all(fd, (char *)cases[i].payload, len, 1) != 0) {
+            fprintf(stderr, "Failed to send request %zu.\n", i + 1);
+            close(fd);
+            return 1;
+        }
+    }
+
+    int failures = 0;
+    for (size_t i = 0; i < count; i++) {
+        unsigned char length[4];
+        char response[256];
+        if (transfer_all(fd, (char *)length, 4, 0) != 0) {
+            fprintf(stderr, "Connection failed after %zu responses.\n", i);
+            close(fd);
+            return 1;
+        }
+        size_t len = (size_t)length[0] << 24 | (size_t)length[1] << 16 | (size_t)length[2] << 8 | length[3];
+        if (len > sizeof(response) || transfer_all(fd, response, len, 0) != 0) {
+            fprintf(stderr, "Response %zu is unreadable.\n", i + 1);
+            close(fd);
+            return 1;
+        }
+        if (len != cases[i].response_len || memcmp(response, cases[i].response, len) != 0) {
+            fprintf(stderr, "Response %zu is wrong.\n", i + 1);
+            failures++;
+        }
+    }
+    close(fd);
+    printf("%d of %zu responses matched\n", (int)count - failures, count);
+    return failures == 0 ? 0 : 1;
+}
+
+/**
+ * @brief Runs one client: `requests` pipelined requests, `depth` at a time.
+ *
+ * @param arg The bench_client.
+ * @return NULL.
+ */
+static void *client_main(void *arg) {
+    bench_client *client = arg;
+    int fd = connect_server(client->socket_path);
+    if (fd < 0) {
+        client->failures = client->requests;
+        return NULL;
+    }
+
+    static const char header[] = "vigenere-encrypt COMPLEXKEY\n";
+    size_t payload_len = sizeof(header) - 1 + client->message_len;
+    char *request = malloc(4 + payload_len);
+    char *response = malloc(payload_len + 1);
+    double *sent_at = malloc(sizeof(double) * (size_t)client->depth);
+    if (request == NULL || response == NULL || sent_at == NULL) {
+        fprintf(stderr, "Memory allocation failed.\n");
+        client->failures = client->requests;
+        free(request);
+        free(response);
+        free(sent_at);
+        close(fd);
+        return NULL;
+    }
+    request[0] = (char)(payload_len >> 24);
+    request[1] = (char)(payload_len >> 16);
+    request[2] = (char)(payload_len >> 8);
+    request[3] = (char)payload_len;
+    memcpy(request + 4, header, sizeof(header) - 1);
+    for (size_t i = 0; i < client->message_len; i++) {
+        request[4 + sizeof(header) - 1 + i] = "THE QUICK BROWN FOX JUMPS OVER THE LAZY DOG. "[i % 45];
+    }
+
+    int sent = 0;
+    for (int done = 0; done < client->requests; done++) {
+        while (sent < client->requests && sent - done < client->depth) {
+            sent_at[sent % client->depth] = now_us();
+            if (transfer_all(fd, request, 4 + payload_len, 1) != 0) {
+                goto broken;
+            }
+            sent++;
+        }
+        unsigned char length[4];
+        if (transfer_all(fd, (char *)length, 4, 0) != 0) {
+            goto broken;
+        }
+        size_t len = (size_t)length[0] << 24 | (size_t)length[1] << 16 | (size_t)length[2] << 8 | length[3];
+        if (len > payload_len + 1 || transfer_all(fd, response, len, 0) != 0) {
+            goto broken;
+        }
+        client->latencies[done] = now_us() - sent_at[done % client->depth];
+        if (response[0] != 0 || len != client->message_len + 1) {
+            client->failures++;
+        }
+        continue;
+broken:
+        fprintf(stderr, "Connection failed after %d responses.\n", done);
+        client->failures += client->requests - done;
+        break;
+    }
+
+    free(request);
+    free(response);
+    free(sent_at);
+    close(fd);
+    return NULL;
+}
+
+/**
+ * @brief Orders doubles ascending, for qsort.
+ */
+static int compare_doubles(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+int main(int argc, char **argv) {
+    if (argc == 3 && strcmp(argv[1], "--check") == 0) {
+        return check_server(argv[2]);
+    }
+    if (argc < 2 || argc > 6) {
+        fprintf(stderr, "Usage: %s <socket> [clients] [requests per client] [pipeline depth] [message bytes]\n", argv[0]);
+        fprintf(stderr, "       %s --check <socket>\n", argv[0]);
+        return 1;
+    }
+    int clients = argc > 2 ? atoi(argv[2]) : 4;
+    int requests = argc > 3 ? atoi(argv[3]) : 100000;
+    int depth = argc > 4 ? atoi(argv[4]) : 16;
+    long message_len = argc > 5 ? atol(argv[5]) : 64;
+    if (clients < 1 || requests < 1 || depth < 1 || message_len < 0) {
+        fprintf(stderr, "All counts must be positive.\n");
+        return 1;
+    }
+
+    size_t total = (size_t)clients * (size_t)requests;
+    double *latencies = calloc(total, sizeof(double));
+    bench_client *state = calloc((size_t)clients, sizeof(*state));
+    pthread_t *ids = calloc((size_t)clients, sizeof(*ids));
+    if (latencies == NULL || state == NULL || ids == NULL) {
+        fprintf(stderr, "Memory allocation failed.\n");
+        return 1;
+    }
+
+    double start = now_us();
+    for (int c = 0; c < clients; c++) {
+        state[c] = (bench_client){ argv[1], requests, depth, (size_t)message_len,
+                                   latencies + (size_t)c * (size_t)requests, 0 };
+        pthread_create(&ids[c], NULL, client_main, &state[c]);
+    }
+    int failures = 0;
+    for (int c = 0; c < clients; c++) {
+        pthread_join(ids[c], NULL);
+        failures += state[c].failures;
+    }
+    double elapsed = (now_us() - start) / 1e6;
+
+    qsort(latencies, total, sizeof(double), compare_doubles);
+    printf("{\"clients\": %d, \"requests\": %zu, \"depth\": %d, \"message_bytes\": %ld, "
+           "\"seconds\": %.3f, \"requests_per_sec\": %.0f, \"p50_us\": %.1f, \"p99_us\": %.1f, "
+           "\"failures\": %d}\n",
+           clients, total, depth, message_len, elapsed, total / elapsed,
+           latencies[total / 2], latencies[total * 99 / 100], failures);
+
+    free(latencies);
+    free(state);
+    free(ids);
+    return failures == 0 ? 0 : 1;
+}
@@ -2,10 +2,53 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <math.h>
+#include <errno.h>
+#include "../crypto.h"
+#include "caesar_crack.h"
 
-#define ALPHABET_SIZE 26
 #define MAX_OUTPUT_WORDS 50
 
+/** Words of decrypted text shown for each rotation of a --top ranking. */
+#define RANKED_PREVIEW_WORDS 10
+
+/** Bytes read from the input at a time in streaming mode. */
+#define STREAM_BLOCK_SIZE (64 * 1024)
+
+/** Size of the first prefix read when deciding the key early; later reads double up to STREAM_BLOCK_SIZE. */
+#define FIRST_PREFIX_SIZE 256
+
+/** Fewest letters an early key decision is based on, so the normal approximation is reasonable. */
+#define DECISION_MIN_LETTERS 100
+
+/** Most bytes of the input kept for the decrypted preview. */
+#define PREVIEW_LIMIT (64 * 1024)
+
+/** Bytes counted between flushes of count_letters' 32-bit bins. */
+#define LETTER_COUNT_CHUNK ((size_t)1 << 30)
+
+/** Relative frequencies of the letters A to Z in English text, in percent. */
+static const double english_frequencies[ALPHABET_SIZE] = {
+    8.167, 1.492, 2.782, 4.253, 12.702, 2.228, 2.015, 6.094,
+    6.966, 0.153, 0.772, 4.025, 2.406, 6.749, 7.507, 1.929,
+    0.095, 5.987, 6.327, 9.056, 2.758, 0.978, 2.360, 0.150,
+    1.974, 0.074
+};
+
+/**
+ * @brief Builds the translation table that decrypts with a given key.
+ *
+ * @param table The table to initialise.
+ * @param key The decryption key (number of positions to shift).
+ *
+ * Upper and lower case letters are each rotated within their own range, so the
+ * per-character work is one table lookup.
+ */
+static void caesar_crack_table(caesar_table *table, int key) {
+    caesar_table_init(table, 'A', 'Z', -key);
+    caesar_table_add_range(table, 'a', 'z', -key);
+}
+
 /**
  * @brief Decrypts a given ciphertext using the Caesar cipher with a specified key.
  *
@@ -13,16 +56,76 @@
  * @param cipher_text Pointer to the null-terminated string containing the ciphertext to be decrypted.
  * @param plain_text Pointer to the buffer where the decrypted text will be stored. The buffer must be large enough to hold the decrypted text.
  */
-void caesar_decrypt(int key, const char *cipher_text, char *plain_text) {
-    for (size_t i = 0; i < strlen(cipher_text); i++) {
-        if (isalpha(cipher_text[i])) {
-            char offset = isupper(cipher_text[i]) ? 'A' : 'a';
-            plain_text[i] = ((cipher_text[i] - offset - key + ALPHABET_SIZE) % ALPHABET_SIZE) + offset;
-        } else {
-            plain_text[i] = cipher_text[i];
+void caesar_crack_decrypt(int key, const char *cipher_text, char *plain_text) {
+    caesar_table table;
+    caesar_crack_table(&table, key);
+
+    size_t len = strlen(cipher_text);
+    caesar_table_apply(&table, cipher_text, plain_text, len);
+    plain_text[len] = '\0';
+}
+
+/**
+ * @brief Adds the letters of a buffer to a case-insensitive letter histogram.
+ *
+ * @param text Pointer to the bytes to count.
+ * @param len The number of bytes.
+ * @param counts The histogram; counts[0] is the number of A and a seen so far, and so on.
+ *
+ * The loop only counts raw byte values, with no test or case folding per byte; letters
+ * are picked out of the 256 bins afterwards. Four interleaved histograms are kept so
+ * that runs of the same byte do not make each increment wait for the previous one.
+ * Counters are 32 bits to keep the bins in L1, so long inputs are counted in chunks
+ * that cannot overflow them.
+ */
+void count_letters(const char *text, size_t len, size_t counts[ALPHABET_SIZE]) {
+    const unsigned char *bytes = (const unsigned char *)text;
+    unsigned partial[4][256] = {{0}};
+    while (len > 0) {
+        size_t chunk = len < LETTER_COUNT_CHUNK ? len : LETTER_COUNT_CHUNK;
+        size_t i = 0;
+        for (; i + 4 <= chunk; i += 4) {
+            partial[0][bytes[i]]++;
+            partial[1][bytes[i + 1]]++;
+            partial[2][bytes[i + 2]]++;
+            partial[3][bytes[i + 3]]++;
+        }
+        for (; i < chunk; i++) {
+            partial[0][bytes[i]]++;
         }
+        for (int letter = 0; letter < ALPHABET_SIZE; letter++) {
+            for (int lane = 0; lane < 4; lane++) {
+                counts[letter] += (size_t)partial[lane]['A' + letter] + partial[lane]['a' + letter];
+            }
+        }
+        memset(partial, 0, sizeof(partial));
+        bytes += chunk;
+        len -= chunk;
     }
-    plain_text[strlen(cipher_text)] = '\0';
+}
+
+/**
+ * @brief Calculates the English score of the text a letter histogram describes, after rotating it back by a key.
+ *
+ * @param counts The letter histogram of the ciphertext.
+ * @param key The decryption key; plaintext letter i has the count of ciphertext letter i + key.
+ * @return The calculated English score, or 0 if there are no letters.
+ */
+double english_score_of_counts(const size_t counts[ALPHABET_SIZE], int key) {
+    size_t total_chars = 0;
+    for (int i = 0; i < ALPHABET_SIZE; i++) {
+        total_chars += counts[i];
+    }
+    if (total_chars == 0) {
+        return 0.0;
+    }
+
+    double score = 0.0;
+    for (int i = 0; i < ALPHABET_SIZE; i++) {
+        double frequency = (double)counts[(i + key) % ALPHABET_SIZE] / total_chars * 100;
+        score += english_frequencies[i] * frequency;
+    }
+    return score;
 }
 
 /**
@@ -34,94 +137,283 @@ void caesar_decrypt(int key, const char *cipher_text, char *plain_text) {
  * The score is calculated by comparing the frequency of each letter in the text to the known frequencies of letters in the English language.
  */
 double calculate_english_score(const char *text) {
-    double frequencies[ALPHABET_SIZE] = {
-        8.167, 1.492, 2.782, 4.253, 12.702, 2.228, 2.015, 6.094,
-        6.966, 0.153, 0.772, 4.025, 2.406, 6.749, 7.507, 1.929,
-        0.095, 5.987, 6.327, 9.056, 2.758, 0.978, 2.360, 0.150,
-        1.974, 0.074
-    };
-    double score = 0.0;
-    int counts[ALPHABET_SIZE] = {0};
-    int total_chars = 0;
+    size_t counts[ALPHABET_SIZE] = {0};
+    count_letters(text, strlen(text), counts);
+    return english_score_of_counts(counts, 0);
+}
 
-    for (size_t i = 0; i < strlen(text); i++) {
-        if (isalpha(text[i])) {
-            counts[tolower(text[i]) - 'a']++;
-            total_chars++;
+/**
+ * @brief Returns the length of the prefix of a text that holds its first n words.
+ *
+ * @param text Pointer to the null-terminated text.
+ * @param n The number of words.
+ * @return The index of the n-th whitespace character, or the length of the text if it has fewer.
+ */
+static size_t first_n_words_length(const char *text, int n) {
+    int word_count = 0;
+    size_t i = 0;
+    for (; text[i] != '\0'; i++) {
+        if (isspace((unsigned char)text[i]) && ++word_count >= n) {
+            break;
         }
     }
+    return i;
+}
 
-    for (int i = 0; i < ALPHABET_SIZE; i++) {
-        double frequency = (double)counts[i] / total_chars * 100;
-        score += frequencies[i] * frequency;
+/**
+ * @brief Decrypts the start of a ciphertext with a given key and writes it to standard output.
+ *
+ * @param cipher_text Pointer to the ciphertext.
+ * @param length The number of characters to decrypt.
+ * @param key The decryption key (number of positions to shift).
+ */
+static void print_decrypted_prefix(const char *cipher_text, size_t length, int key) {
+    caesar_table table;
+    caesar_crack_table(&table, key);
+    char block[4096];
+    while (length > 0) {
+        size_t n = length < sizeof(block) ? length : sizeof(block);
+        caesar_table_apply(&table, cipher_text, block, n);
+        fwrite(block, 1, n, stdout);
+        cipher_text += n;
+        length -= n;
     }
-
-    return score;
 }
 
 /**
- * @brief Prints the first n words of a given text.
+ * @brief Picks the best key from the letter histogram of a ciphertext.
  *
- * @param text Pointer to the null-terminated string containing the text to print.
- * @param n The number of words to print.
+ * @param counts The letter histogram of the ciphertext.
+ * @param result Pointer to the structure that receives the best key, its score, the ranking of every key and the number of keys tried.
+ *
+ * Rotating a text rotates its histogram, so every key is scored from the one histogram
+ * without decrypting anything. There are only 26 keys, so all of them are ranked, by
+ * insertion as they are scored.
  */
-void print_first_n_words(const char *text, int n) {
-    int word_count = 0;
-    for (size_t i = 0; i < strlen(text); i++) {
-        if (isspace(text[i])) {
-            word_count++;
+void crack_caesar_counts(const size_t counts[ALPHABET_SIZE], caesar_crack_result *result) {
+    result->key = 0;
+    result->score = 0.0;
+    result->candidates = 0;
+    result->bytes = 0;
+    result->stopped_early = 0;
+
+    for (int key = 0; key < ALPHABET_SIZE; key++) {
+        double score = english_score_of_counts(counts, key);
+        result->candidates++;
+        result->scores[key] = score;
+
+        int rank = key;
+        for (; rank > 0 && result->scores[result->ranking[rank - 1]] < score; rank--) {
+            result->ranking[rank] = result->ranking[rank - 1];
         }
-        if (word_count >= n) {
-            printf("\n");
-            return;
+        result->ranking[rank] = key;
+
+        if (score > result->score) {
+            result->score = score;
+            result->key = key;
         }
-        putchar(text[i]);
     }
-    printf("\n");
 }
 
 /**
  * @brief Attempts to crack a Caesar cipher by trying all possible keys and choosing the best result based on English letter frequencies.
  *
  * @param cipher_text Pointer to the null-terminated string containing the ciphertext to crack.
+ * @param result Pointer to the structure that receives the best key, its score and the number of keys tried.
  *
- * This function finds the best decryption key by scoring the decrypted text with each possible key and choosing the one with the highest score.
+ * The ciphertext is read once to build its letter histogram, and all keys are scored from that.
  */
-void crack_caesar_cipher(const char *cipher_text) {
+void crack_caesar_cipher(const char *cipher_text, caesar_crack_result *result) {
+    size_t counts[ALPHABET_SIZE] = {0};
     size_t len = strlen(cipher_text);
-    char *best_plain_text = malloc(len + 1);
-    if (!best_plain_text) {
-        perror("Failed to allocate memory");
-        exit(1);
+    count_letters(cipher_text, len, counts);
+    crack_caesar_counts(counts, result);
+    result->bytes = len;
+}
+
+/**
+ * @brief Prints the result of crack_caesar_cipher.
+ *
+ * @param cipher_text Pointer to the null-terminated string containing the ciphertext that was cracked.
+ * @param result Pointer to the result of cracking it.
+ *
+ * Decryption leaves whitespace alone, so the words to print are found in the ciphertext
+ * and only that prefix is decrypted.
+ */
+void print_crack_result(const char *cipher_text, const caesar_crack_result *result) {
+    printf("Best rotation: %d\n", result->key);
+    printf("Probability score: %.2f\n", result->score);
+    if (result->stopped_early) {
+        printf("Key decided after %zu bytes\n", result->bytes);
     }
-    double best_score = 0.0;
-    int best_key = 0;
+    printf("First %d words of decrypted output:\n", MAX_OUTPUT_WORDS);
+    print_decrypted_prefix(cipher_text, first_n_words_length(cipher_text, MAX_OUTPUT_WORDS), result->key);
+    printf("\n");
+}
 
-    for (int key = 0; key < ALPHABET_SIZE; key++) {
-        char *plain_text = malloc(len + 1);
-        if (!plain_text) {
-            perror("Failed to allocate memory");
-            free(best_plain_text);
-            exit(1);
+/**
+ * @brief Prints the best rotations of a crack_caesar_cipher result.
+ *
+ * @param cipher_text Pointer to the null-terminated string containing the ciphertext that was cracked.
+ * @param result Pointer to the result of cracking it.
+ * @param top The number of rotations to print; at most ALPHABET_SIZE are.
+ *
+ * As in print_crack_result, only the first RANKED_PREVIEW_WORDS words are decrypted,
+ * once for each rotation printed.
+ */
+void print_ranked_rotations(const char *cipher_text, const caesar_crack_result *result, int top) {
+    int count = top < ALPHABET_SIZE ? top : ALPHABET_SIZE;
+    size_t length = first_n_words_length(cipher_text, RANKED_PREVIEW_WORDS);
+    printf("Top %d rotations:\n", count);
+    for (int i = 0; i < count; i++) {
+        int key = result->ranking[i];
+        printf("  %d. rotation %d (score %.2f): ", i + 1, key, result->scores[key]);
+        print_decrypted_prefix(cipher_text, length, key);
+        printf("\n");
+    }
+}
+
+/**
+ * @brief Returns the z-score a key's lead must reach for a given confidence.
+ *
+ * @param confidence The required probability, between 0 and 1, that the leading key beats every other key.
+ * @return The one-sided standard normal quantile, with a Bonferroni correction for the 25 comparisons.
+ */
+static double decision_z_score(double confidence) {
+    double alpha = (1.0 - confidence) / (ALPHABET_SIZE - 1);
+    double low = 0.0, high = 40.0;
+    for (int i = 0; i < 100; i++) {
+        double mid = (low + high) / 2;
+        if (0.5 * erfc(mid / sqrt(2.0)) > alpha) {
+            low = mid;
+        } else {
+            high = mid;
         }
-        caesar_decrypt(key, cipher_text, plain_text);
-        double score = calculate_english_score(plain_text);
+    }
+    return high;
+}
 
-        if (score > best_score) {
-            best_score = score;
-            best_key = key;
-            strcpy(best_plain_text, plain_text);
+/**
+ * @brief Decides whether a key's lead over every other key is statistically significant.
+ *
+ * @param counts The letter histogram of the ciphertext read so far.
+ * @param best_key The key with the highest score.
+ * @param confidence The required probability, between 0 and 1, that best_key is the key with the highest expected score.
+ * @return 1 if the lead is decisive, 0 if more text is needed.
+ *
+ * A key's score is the mean, over the letters read, of 100 times the English frequency
+ * of each letter once decrypted. For each other key, the difference between the two
+ * scores is therefore a mean of per-letter differences, whose variance is estimated from
+ * the same histogram; the lead is decisive when every difference is at least the
+ * required number of standard errors.
+ */
+int caesar_key_decided(const size_t counts[ALPHABET_SIZE], int best_key, double confidence) {
+    size_t total_chars = 0;
+    for (int c = 0; c < ALPHABET_SIZE; c++) {
+        total_chars += counts[c];
+    }
+    if (total_chars < DECISION_MIN_LETTERS) {
+        return 0;
+    }
+    double z = decision_z_score(confidence);
+
+    for (int key = 0; key < ALPHABET_SIZE; key++) {
+        if (key == best_key) {
+            continue;
         }
+        double sum = 0.0, sum_squares = 0.0;
+        for (int c = 0; c < ALPHABET_SIZE; c++) {
+            double difference = 100 * (english_frequencies[(c - best_key + ALPHABET_SIZE) % ALPHABET_SIZE]
+                                       - english_frequencies[(c - key + ALPHABET_SIZE) % ALPHABET_SIZE]);
+            sum += counts[c] * difference;
+            sum_squares += counts[c] * difference * difference;
+        }
+        double mean = sum / total_chars;
+        double variance = sum_squares / total_chars - mean * mean;
+        if (mean <= 0 || mean * mean * total_chars < z * z * variance) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief Cracks a Caesar cipher read from a stream, in bounded memory.
+ *
+ * @param in The stream to read the ciphertext from.
+ * @param confidence 0 to read the whole stream, or the confidence (between 0 and 1) at which to stop reading early; see caesar_key_decided.
+ * @param result Pointer to the structure that receives the best key, its score, the number of keys tried and the bytes read.
+ * @param preview Pointer to a buffer that receives the start of the ciphertext, null-terminated, for print_crack_result.
+ * @param preview_size The size of the preview buffer.
+ * @return 0 on success, -1 if the stream could not be read.
+ *
+ * The ciphertext is read in fixed-size blocks and only its letter histogram and the
+ * preview are kept, so memory use does not depend on the length of the input and
+ * pipes work as well as files. With a confidence, the reads start small and double, and
+ * the key is checked after each one, so a clear-cut key is found after a few kilobytes
+ * however large the input is; the preview is still filled if the input has more.
+ */
+int crack_caesar_stream(FILE *in, double confidence, caesar_crack_result *result, char *preview, size_t preview_size) {
+    char block[STREAM_BLOCK_SIZE];
+    size_t counts[ALPHABET_SIZE] = {0};
+    size_t preview_len = 0;
+    size_t want = confidence > 0 ? FIRST_PREFIX_SIZE : sizeof(block);
+    size_t bytes = 0;
+    int decided = 0;
+    size_t n;
 
-        free(plain_text);
+    while (!decided && (n = fread(block, 1, want, in)) > 0) {
+        if (preview_len + 1 < preview_size) {
+            size_t keep = preview_size - 1 - preview_len < n ? preview_size - 1 - preview_len : n;
+            memcpy(preview + preview_len, block, keep);
+            preview_len += keep;
+        }
+        count_letters(block, n, counts);
+        bytes += n;
+        if (confidence > 0) {
+            crack_caesar_counts(counts, result);
+            decided = caesar_key_decided(counts, result->key, confidence);
+            want = want * 2 < sizeof(block) ? want * 2 : sizeof(block);
+        }
+    }
+    while (decided && preview_len + 1 < preview_size
+            && (n = fread(preview + preview_len, 1, preview_size - 1 - preview_len, in)) > 0) {
+        preview_len += n;
+    }
+    if (preview_size > 0) {
+        preview[preview_len] = '\0';
+    }
+    if (ferror(in)) {
+        return -1;
     }
 
-    printf("Best rotation: %d\n", best_key);
-    printf("Probability score: %.2f\n", best_score);
-    printf("First %d words of decrypted output:\n", MAX_OUTPUT_WORDS);
-    print_first_n_words(best_plain_text, MAX_OUTPUT_WORDS);
+    crack_caesar_counts(counts, result);
+    result->bytes = bytes;
+    result->stopped_early = decided;
+    return 0;
+}
 
-    free(best_plain_text);
+/**
+ * @brief Decrypts a stream with a given key, block by block.
+ *
+ * @param in The stream to read the ciphertext from; read to the end.
+ * @param out The stream to write the plaintext to.
+ * @param key The decryption key (number of positions to shift).
+ * @return 0 on success, -1 on a read or write error.
+ */
+int decrypt_caesar_stream(FILE *in, FILE *out, int key) {
+    caesar_table table;
+    caesar_crack_table(&table, key);
+    char block[STREAM_BLOCK_SIZE];
+    size_t n;
+
+    while ((n = fread(block, 1, sizeof(block), in)) > 0) {
+        caesar_table_apply(&table, block, block, n);
+        if (fwrite(block, 1, n, out) != n) {
+            return -1;
+        }
+    }
+    return ferror(in) ? -1 : 0;
 }
 
 /**
@@ -130,8 +422,15 @@ void crack_caesar_cipher(const char *cipher_text) {
  * This function prints the correct usage of the program and provides examples of the expected output.
  */
 void print_usage() {
-    printf("Usage: caesar_cracker <ciphertext_file>\n");
-    printf("Attempts to crack a Caesar cipher by trying all possible keys.\n\n");
+    printf("Usage: caesar_cracker [--decrypt | --top K] [--confidence P] <ciphertext_file | ->\n");
+    printf("Attempts to crack a Caesar cipher by trying all possible keys.\n");
+    printf("The ciphertext is streamed, so it may be larger than memory; - reads standard input.\n");
+    printf("With --decrypt, the whole plaintext is written to standard output and the key and\n");
+    printf("score to standard error; this needs a seekable input.\n");
+    printf("With --confidence P (e.g. 0.999999), reading stops as soon as the best key beats every\n");
+    printf("other key with probability P, and the number of bytes it took is reported.\n");
+    printf("With --top K, the K best rotations are also listed with their scores and the first\n");
+    printf("%d words each decrypts to.\n\n", RANKED_PREVIEW_WORDS);
     printf("Expected output:\n");
     printf("Best rotation: <key>\n");
     printf("Probability score: <score>\n");
@@ -139,6 +438,7 @@ void print_usage() {
     printf("<decrypted text>\n");
 }
 
+#ifndef CRACK_NO_MAIN
 /**
  * @brief Main function for the Caesar cipher cracker program.
  *
@@ -146,43 +446,85 @@ void print_usage() {
  * @param argv The array of command-line arguments.
  * @return 0 if the program completes successfully, 1 otherwise.
  *
- * This function reads a ciphertext from a file, attempts to crack it using a Caesar cipher, and prints the results.
+ * This function streams a ciphertext from a file or standard input, attempts to crack it using a Caesar cipher, and prints the results.
  * If the -h flag is provided, it prints usage information.
  */
 int main(int argc, char *argv[]) {
-    if (argc != 2) {
+    int decrypt = 0;
+    int top = 0;
+    double confidence = 0;
+    int arg = 1;
+    for (; arg < argc - 1; arg++) {
+        if (strcmp(argv[arg], "--decrypt") == 0) {
+            decrypt = 1;
+        } else if (strcmp(argv[arg], "--top") == 0 && arg + 1 < argc - 1) {
+            char *end;
+            errno = 0;
+            long parsed = strtol(argv[++arg], &end, 10);
+            if (end == argv[arg] || *end != '\0' || errno == ERANGE || parsed < 1 || parsed > ALPHABET_SIZE) {
+                fprintf(stderr, "--top needs a number of rotations from 1 to %d.\n", ALPHABET_SIZE);
+                return 1;
+            }
+            top = (int)parsed;
+        } else if (strcmp(argv[arg], "--confidence") == 0 && arg + 1 < argc - 1) {
+            char *end;
+            confidence = strtod(argv[++arg], &end);
+            if (*end != '\0' || !(confidence > 0 && confidence < 1)) {
+                fprintf(stderr, "Confidence must be a number between 0 and 1.\n");
+                return 1;
+            }
+        } else {
+            break;
+        }
+    }
+    if (arg != argc - 1 || (decrypt && top > 0)) {
         print_usage();
         return 1;
     }
+    const char *path = argv[arg];
 
-    if (strcmp(argv[1], "-h") == 0) {
+    if (strcmp(path, "-h") == 0) {
         print_usage();
         return 0;
     }
 
-    FILE *file = fopen(argv[1], "r");
+    FILE *file = strcmp(path, "-") == 0 ? stdin : fopen(path, "r");
     if (!file) {
         perror("Failed to open file");
         return 1;
     }
 
-    fseek(file, 0, SEEK_END);
-    long length = ftell(file);
-    fseek(file, 0, SEEK_SET);
-
-    char *cipher_text = malloc(length + 1);
-    if (!cipher_text) {
-        perror("Failed to allocate memory");
-        fclose(file);
+    static char preview[PREVIEW_LIMIT + 1];
+    caesar_crack_result result;
+    if (crack_caesar_stream(file, confidence, &result, preview, sizeof(preview)) != 0) {
+        perror("Failed to read file");
+        if (file != stdin) fclose(file);
         return 1;
     }
 
-    fread(cipher_text, 1, length, file);
-    cipher_text[length] = '\0';
-    fclose(file);
-
-    crack_caesar_cipher(cipher_text);
-    free(cipher_text);
+    int status = 0;
+    if (!decrypt) {
+        print_crack_result(preview, &result);
+        if (top > 0) {
+            print_ranked_rotations(preview, &result, top);
+        }
+    } else if (fseek(file, 0, SEEK_SET) != 0) {
+        perror("Cannot rewind the input to decrypt it");
+        status = 1;
+    } else {
+        fprintf(stderr, "Best rotation: %d\n", result.key);
+        fprintf(stderr, "Probability score: %.2f\n", result.score);
+        if (result.stopped_early) {
+            fprintf(stderr, "Key decided after %zu bytes\n", result.bytes);
+        }
+        clearerr(file);
+        if (decrypt_caesar_stream(file, stdout, result.key) != 0 || fflush(stdout) != 0) {
+            perror("Failed to decrypt file");
+            status = 1;
+        }
+    }
 
-    return 0;
+    if (file != stdin) fclose(file);
+    return status;
 }
+#endif
@@ -0,0 +1,84 @@
+#ifndef CAESAR_CRACK_H
+#define CAESAR_CRACK_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+#define ALPHABET_SIZE 26
+
+/** The outcome of cracking a Caesar ciphertext. */
+typedef struct {
+    int key;                /**< The best rotation, 0 to 25. */
+    double score;           /**< Its English score; higher is more English-like. */
+    size_t candidates;      /**< The number of rotations scored. */
+    size_t bytes;           /**< The number of ciphertext bytes read. */
+    int stopped_early;      /**< Non-zero if reading stopped once the key was decided. */
+    double scores[ALPHABET_SIZE]; /**< The score of each rotation. */
+    int ranking[ALPHABET_SIZE];   /**< Every rotation, best first; ties go to the smaller rotation. */
+} caesar_crack_result;
+
+/** Decrypt `cipher_text` by rotating each letter back by `key` positions, keeping case.
+  *
+  * \param plain_text A buffer of at least strlen(cipher_text) + 1 bytes.
+  */
+void caesar_crack_decrypt(int key, const char * cipher_text, char * plain_text);
+
+/** Add the letters of `text[0..len)` to `counts`, ignoring case: counts[0] is A and a. */
+void count_letters(const char * text, size_t len, size_t counts[ALPHABET_SIZE]);
+
+/** Score how English-like the text with letter histogram `counts` is once decrypted
+  * with `key`; higher is better. No text is needed: decrypting rotates the histogram.
+  */
+double english_score_of_counts(const size_t counts[ALPHABET_SIZE], int key);
+
+/** Score how English-like the letters of `text` are; higher is better. */
+double calculate_english_score(const char * text);
+
+/** Find the best rotation from the letter histogram of a ciphertext. */
+void crack_caesar_counts(const size_t counts[ALPHABET_SIZE], caesar_crack_result * result);
+
+/** Find the rotation of `cipher_text` whose decryption scores as the most English-like.
+  *
+  * The text is read once, to build its letter histogram, and nothing is printed; see
+  * `print_crack_result`.
+  *
+  * \param result Receives the best rotation, its score and the work done.
+  */
+void crack_caesar_cipher(const char * cipher_text, caesar_crack_result * result);
+
+/** Decide whether `best_key`'s lead over each other key, given the letter histogram
+  * `counts`, is significant at probability `confidence` (between 0 and 1).
+  *
+  * \return 1 if it is, 0 if more ciphertext is needed.
+  */
+int caesar_key_decided(const size_t counts[ALPHABET_SIZE], int best_key, double confidence);
+
+/** Crack a ciphertext read from `in` in fixed-size blocks, keeping only its letter
+  * histogram and its first `preview_size - 1` bytes (null-terminated in `preview`), so
+  * memory use is constant however long the input is. Works on pipes.
+  *
+  * With `confidence` 0 the whole stream is read. Otherwise reading stops as soon as
+  * `caesar_key_decided` is satisfied, and `result->bytes` says how much was read.
+  *
+  * \return 0 on success, -1 if the stream could not be read.
+  */
+int crack_caesar_stream(FILE * in, double confidence, caesar_crack_result * result,
+                        char * preview, size_t preview_size);
+
+/** Decrypt everything remaining in `in` with `key` and write it to `out`, block by block.
+  *
+  * \return 0 on success, -1 on a read or write error.
+  */
+int decrypt_caesar_stream(FILE * in, FILE * out, int key);
+
+/** Print the best rotation, its score and the start of the decrypted text. Only the
+  * printed words are decrypted.
+  */
+void print_crack_result(const char * cipher_text, const caesar_crack_result * result);
+
+/** Print the `top` best rotations (at most ALPHABET_SIZE), each with its score and the
+  * first few words of `cipher_text` it decrypts to. Only those words are decrypted.
+  */
+void print_ranked_rotations(const char * cipher_text, const caesar_crack_result * result, int top);
+
+#endif
@@ -11,60 +11,70 @@
  * @bug No known bugs.
  */
 
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
 #include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "crypto.h"
+#include "cli.h"
 
 
 int isValidInteger(const char *str);
 
 int isKeyValidForRange(const char *key, char low, char high);
 
+/** Size of the buffer used to stream input through the cipher. */
+#define STREAM_BLOCK_SIZE (64 * 1024)
+
+/** With --threads, each worker gets this much of every streamed block. */
+#define STREAM_BLOCK_PER_THREAD (1024 * 1024)
+
+/** Largest value accepted for --threads. */
+#define MAX_THREADS 256
+
 /**
- * @brief Main function for the command-line interface.
- *
- * @param argc The number of command-line arguments.
- * @param argv The array of command-line arguments.
- * @return 0 if the program completes successfully, non-zero otherwise.
+ * @brief Parses a --threads value.
  *
- * This function handles command-line arguments to perform encryption or decryption
- * using Caesar or Vigenere ciphers. The user must provide the operation type,
- * the key, and the message as arguments.
- * 
- * Usage: <operation> <key> <message>
- * - operation: "caesar-encrypt", "caesar-decrypt", "vigenere-encrypt", "vigenere-decrypt"
- * - key: The encryption/decryption key
- * - message: The input message to encrypt or decrypt
- * 
- * \pre `argc` must be 4.
- * \pre `argv` must contain valid strings for the operation, key, and message.
+ * @param text The option value.
+ * @param threads Receives the thread count.
+ * @return 1 if the whole of text is a number from 1 to MAX_THREADS, 0 otherwise.
  */
-int cli(int argc, char **argv) {
-    if (argc != 4) {
-        fprintf(stderr, "Usage: %s <operation> <key> <message>\n", argv[0]);
-        return 1;
+static int parse_thread_count(const char *text, int *threads) {
+    char *end;
+    errno = 0;
+    long count = strtol(text, &end, 10);
+    if (end == text || *end != '\0' || errno == ERANGE || count < 1 || count > MAX_THREADS) {
+        return 0;
     }
+    *threads = (int)count;
+    return 1;
+}
 
-    const char *operation = argv[1];
-    const char *key_text = argv[2];
-    const char *message = argv[3];
-
-    // Allocate memory for the result dynamically
-    size_t message_length = strlen(message);
-    char *result = (char *)malloc(message_length + 1);
-    if (result == NULL) {
-        fprintf(stderr, "Memory allocation failed.\n");
-        return 1;
-    }
+/**
+ * @brief Validates the operation and key, and prepares a cipher context for them.
+ *
+ * @param operation The operation name given on the command line.
+ * @param key_text The key given on the command line.
+ * @param ctx The context to initialise.
+ * @param error Buffer that receives a one-line description of any failure.
+ * @param error_size The size of the error buffer.
+ * @return 0 on success, 1 if the operation or key is invalid or allocation fails.
+ */
+int prepare_cipher(const char *operation, const char *key_text, cipher_ctx *ctx, char *error, size_t error_size) {
+    int rc;
 
     // Validate the operation type and key format
     if (strcmp(operation, "caesar-encrypt") == 0 || strcmp(operation, "caesar-decrypt") == 0) {
         if (!isValidInteger(key_text)) {
-            fprintf(stderr, "Invalid key: Caesar cipher key must be a valid integer.\n");
-            free(result);
+            snprintf(error, error_size, "Invalid key: Caesar cipher key must be a valid integer.");
             return 1;
         }
         int key = atoi(key_text);  // Convert key to integer
@@ -72,40 +82,319 @@ int cli(int argc, char **argv) {
         // Validate key range for Caesar cipher
         int range_size = 'Z' - 'A' + 1;
         if (key < 0 || key >= range_size) {
-            fprintf(stderr, "Key %d is out of valid range [0, %d]\n", key, range_size - 1);
-            free(result);
+            snprintf(error, error_size, "Key %d is out of valid range [0, %d]", key, range_size - 1);
             return 1;
         }
 
         if (strcmp(operation, "caesar-encrypt") == 0) {
-            caesar_encrypt('A', 'Z', key, message, result);
+            rc = caesar_encrypt_init(ctx, 'A', 'Z', key);
         } else {
-            caesar_decrypt('A', 'Z', key, message, result);
+            rc = caesar_decrypt_init(ctx, 'A', 'Z', key);
         }
     } else if (strcmp(operation, "vigenere-encrypt") == 0 || strcmp(operation, "vigenere-decrypt") == 0) {
-        if (!isKeyValidForRange(key_text, 'A', 'Z')) {
-            fprintf(stderr, "Key contains invalid characters for the specified range.\n");
-            free(result);
+        if (key_text[0] == '\0' || !isKeyValidForRange(key_text, 'A', 'Z')) {
+            snprintf(error, error_size, "Key contains invalid characters for the specified range.");
             return 1;
         }
 
         if (strcmp(operation, "vigenere-encrypt") == 0) {
-            vigenere_encrypt('A', 'Z', key_text, message, result);
+            rc = vigenere_encrypt_init(ctx, 'A', 'Z', key_text);
         } else {
-            vigenere_decrypt('A', 'Z', key_text, message, result);
+            rc = vigenere_decrypt_init(ctx, 'A', 'Z', key_text);
         }
     } else {
-        fprintf(stderr, "Invalid operation. Use 'caesar-encrypt', 'caesar-decrypt', 'vigenere-encrypt', or 'vigenere-decrypt'.\n");
-        free(result);
+        snprintf(error, error_size, "Invalid operation. Use 'caesar-encrypt', 'caesar-decrypt', 'vigenere-encrypt', or 'vigenere-decrypt'.");
+        return 1;
+    }
+
+    if (rc != 0) {
+        snprintf(error, error_size, "Memory allocation failed.");
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Streams an input file through the cipher into an output file.
+ *
+ * @param ctx The prepared cipher context.
+ * @param in The stream to read from.
+ * @param out The stream to write to.
+ * @param threads The number of threads to transform each block with.
+ * @return 0 on success, 1 on a read, write or allocation error.
+ *
+ * Input is processed in fixed-size blocks through a single reused buffer, so memory use
+ * does not depend on the size of the input. With more than one thread the block grows
+ * to STREAM_BLOCK_PER_THREAD per thread, so each worker has enough to do. Bytes are
+ * written exactly as transformed; no trailing newline is added.
+ */
+static int stream_cipher(cipher_ctx *ctx, FILE *in, FILE *out, int threads) {
+    size_t block_size = threads > 1 ? (size_t)threads * STREAM_BLOCK_PER_THREAD : STREAM_BLOCK_SIZE;
+    char *buffer = malloc(block_size);
+    if (buffer == NULL) {
+        fprintf(stderr, "Memory allocation failed.\n");
         return 1;
     }
 
-    // Print the result to standard output and return 0 for success
-    printf("%s\n", result);
-    free(result);
+    size_t n;
+    while ((n = fread(buffer, 1, block_size, in)) > 0) {
+        cipher_update_parallel(ctx, buffer, buffer, n, threads);
+        if (fwrite(buffer, 1, n, out) != n) {
+            perror("Failed to write output");
+            free(buffer);
+            return 1;
+        }
+    }
+    free(buffer);
+
+    if (ferror(in)) {
+        perror("Failed to read input");
+        return 1;
+    }
     return 0;
 }
 
+/**
+ * @brief Transforms one file into another through memory mappings.
+ *
+ * @param ctx The prepared cipher context.
+ * @param in_path The file to read.
+ * @param out_path The file to write; created or truncated, then allocated to match the input.
+ * @param threads The number of threads to transform with.
+ * @return 0 on success, 1 on any file, mapping or write-back error.
+ *
+ * The cipher runs directly from the input mapping into the output mapping, so the data
+ * is never copied through a user-space buffer and no read or write calls are made. Both
+ * mappings are advised as sequential so the kernel reads ahead and drops pages behind.
+ * If both paths name the same file, it is mapped once and transformed in place.
+ */
+static int mmap_cipher(cipher_ctx *ctx, const char *in_path, const char *out_path, int threads) {
+    struct stat in_stat, out_stat;
+    int in_fd = open(in_path, O_RDONLY);
+    if (in_fd < 0 || fstat(in_fd, &in_stat) != 0) {
+        perror("Failed to open input file");
+        if (in_fd >= 0) close(in_fd);
+        return 1;
+    }
+    if (!S_ISREG(in_stat.st_mode)) {
+        fprintf(stderr, "--mmap needs a regular input file; stream it instead.\n");
+        close(in_fd);
+        return 1;
+    }
+    size_t len = (size_t)in_stat.st_size;
+    int in_place = stat(out_path, &out_stat) == 0
+        && out_stat.st_dev == in_stat.st_dev && out_stat.st_ino == in_stat.st_ino;
+
+    int out_fd = open(out_path, in_place ? O_RDWR : O_RDWR | O_CREAT | O_TRUNC, 0666);
+    if (out_fd < 0) {
+        perror("Failed to open output file");
+        close(in_fd);
+        return 1;
+    }
+    // Reserve the blocks up front: running out of space while writing through a mapping
+    // raises SIGBUS instead of returning an error.
+    int rc = in_place || len == 0 ? 0 : posix_fallocate(out_fd, 0, in_stat.st_size);
+    if (rc != 0) {
+        fprintf(stderr, "Failed to size output file: %s\n", strerror(rc));
+        close(in_fd);
+        close(out_fd);
+        return 1;
+    }
+    if (len == 0) {
+        close(in_fd);
+        close(out_fd);
+        return 0;
+    }
+
+    char *output = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, out_fd, 0);
+    char *input = in_place ? output : mmap(NULL, len, PROT_READ, MAP_PRIVATE, in_fd, 0);
+    close(in_fd);
+    close(out_fd);
+    if (output == MAP_FAILED || input == MAP_FAILED) {
+        perror("Failed to map file");
+        if (output != MAP_FAILED) munmap(output, len);
+        if (input != MAP_FAILED && !in_place) munmap(input, len);
+        return 1;
+    }
+    posix_madvise(input, len, POSIX_MADV_SEQUENTIAL);
+    if (!in_place) {
+        posix_madvise(output, len, POSIX_MADV_SEQUENTIAL);
+    }
+
+    cipher_update_parallel(ctx, input, output, len, threads);
+
+    // munmap does not report write-back errors, so flush the output first and check.
+    int status = 0;
+    if (msync(output, len, MS_SYNC) != 0) {
+        perror("Failed to write output file");
+        status = 1;
+    }
+    if (!in_place) munmap(input, len);
+    munmap(output, len);
+    return status;
+}
+
+/**
+ * @brief Main function for the command-line interface.
+ *
+ * @param argc The number of command-line arguments.
+ * @param argv The array of command-line arguments.
+ * @return 0 if the program completes successfully, non-zero otherwise.
+ *
+ * This function handles command-line arguments to perform encryption or decryption
+ * using Caesar or Vigenere ciphers. The user must provide the operation type and
+ * the key, and either the message as an argument or a stream to read it from.
+ * 
+ * Usage: <operation> <key> [--threads N] <message>
+ *        <operation> <key> [--threads N] [--in FILE] [--out FILE]
+ *        <operation> <key> [--threads N] --mmap --in FILE --out FILE
+ *        --batch | --batch-length
+ *        --serve SOCKET [--threads N]
+ * - operation: "caesar-encrypt", "caesar-decrypt", "vigenere-encrypt", "vigenere-decrypt"
+ * - key: The encryption/decryption key
+ * - message: The input message to encrypt or decrypt; the result is printed followed
+ *   by a newline
+ * - --in FILE: read the message from FILE instead (default: standard input)
+ * - --out FILE: write the result to FILE instead of standard output
+ * - --threads N: split large inputs across N threads (default: 1)
+ * - --mmap: map the input and output files into memory and transform directly between
+ *   them instead of streaming; requires regular files for both --in and --out
+ * - --batch: read one "<operation> <key> <message>" job per line from standard input
+ *   and write one result line per job (see run_batch)
+ * - --batch-length: as --batch, but each job is "<operation> <key> <length>" followed
+ *   by exactly <length> bytes of message
+ * - --serve SOCKET: run as a daemon answering framed requests on the Unix domain socket
+ *   SOCKET with N worker threads (default: one per CPU) until interrupted (see serve.c)
+ *
+ * When no message argument is given, the input is streamed through a fixed-size
+ * buffer and written out unchanged in length, so arbitrarily large inputs can be
+ * processed in constant memory.
+ * 
+ * \pre `argc` must be at least 3, or 2 for the batch modes.
+ * \pre `argv` must contain valid strings for the operation and key.
+ */
+int cli(int argc, char **argv) {
+    const char *message = NULL;
+    const char *in_path = NULL;
+    const char *out_path = NULL;
+    int threads = 1;
+    int use_mmap = 0;
+
+    if (argc == 2 && strcmp(argv[1], "--batch") == 0) {
+        return run_batch(stdin, stdout, BATCH_LINES);
+    }
+    if (argc == 2 && strcmp(argv[1], "--batch-length") == 0) {
+        return run_batch(stdin, stdout, BATCH_LENGTH);
+    }
+    if ((argc == 3 || argc == 5) && strcmp(argv[1], "--serve") == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus > 0 && cpus <= MAX_THREADS ? (int)cpus : 1;
+        if (argc == 5 && (strcmp(argv[3], "--threads") != 0 || !parse_thread_count(argv[4], &threads))) {
+            fprintf(stderr, "Invalid thread count: must be between 1 and %d.\n", MAX_THREADS);
+            return 1;
+        }
+        return run_server(argv[2], threads);
+    }
+
+    if (argc < 3) {
+        fprintf(stderr, "Usage: %s <operation> <key> [--threads N] <message>\n", argv[0]);
+        fprintf(stderr, "       %s <operation> <key> [--threads N] [--in FILE] [--out FILE]\n", argv[0]);
+        fprintf(stderr, "       %s <operation> <key> [--threads N] --mmap --in FILE --out FILE\n", argv[0]);
+        fprintf(stderr, "       %s --batch | --batch-length\n", argv[0]);
+        fprintf(stderr, "       %s --serve SOCKET [--threads N]\n", argv[0]);
+        return 1;
+    }
+
+    for (int i = 3; i < argc; i++) {
+        if (strcmp(argv[i], "--in") == 0 && i + 1 < argc) {
+            in_path = argv[++i];
+        } else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+            out_path = argv[++i];
+        } else if (strcmp(argv[i], "--mmap") == 0) {
+            use_mmap = 1;
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            if (!parse_thread_count(argv[++i], &threads)) {
+                fprintf(stderr, "Invalid thread count: must be between 1 and %d.\n", MAX_THREADS);
+                return 1;
+            }
+        } else if (message == NULL && i == argc - 1) {
+            message = argv[i];
+        } else {
+            fprintf(stderr, "Unexpected argument: %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    if (message != NULL && (in_path != NULL || out_path != NULL)) {
+        fprintf(stderr, "A message argument cannot be combined with --in or --out.\n");
+        return 1;
+    }
+
+    if (use_mmap && (in_path == NULL || out_path == NULL)) {
+        fprintf(stderr, "--mmap requires both --in and --out.\n");
+        return 1;
+    }
+
+    const char *operation = argv[1];
+    const char *key_text = argv[2];
+
+    cipher_ctx ctx;
+    char error[256];
+    if (prepare_cipher(operation, key_text, &ctx, error, sizeof(error)) != 0) {
+        fprintf(stderr, "%s\n", error);
+        return 1;
+    }
+
+    if (message != NULL) {
+        // Allocate memory for the result dynamically
+        size_t message_length = strlen(message);
+        char *result = (char *)malloc(message_length + 1);
+        if (result == NULL) {
+            fprintf(stderr, "Memory allocation failed.\n");
+            cipher_final(&ctx);
+            return 1;
+        }
+        cipher_update_parallel(&ctx, message, result, message_length, threads);
+        result[message_length] = '\0';
+        cipher_final(&ctx);
+
+        // Print the result to standard output and return 0 for success
+        printf("%s\n", result);
+        free(result);
+        return 0;
+    }
+
+    if (use_mmap) {
+        int status = mmap_cipher(&ctx, in_path, out_path, threads);
+        cipher_final(&ctx);
+        return status;
+    }
+
+    FILE *in = stdin;
+    FILE *out = stdout;
+    if (in_path != NULL && (in = fopen(in_path, "rb")) == NULL) {
+        perror("Failed to open input file");
+        cipher_final(&ctx);
+        return 1;
+    }
+    if (out_path != NULL && (out = fopen(out_path, "wb")) == NULL) {
+        perror("Failed to open output file");
+        if (in != stdin) fclose(in);
+        cipher_final(&ctx);
+        return 1;
+    }
+
+    int status = stream_cipher(&ctx, in, out, threads);
+    cipher_final(&ctx);
+
+    if (in != stdin) fclose(in);
+    if ((out == stdout ? fflush(out) : fclose(out)) != 0) {
+        perror("Failed to write output");
+        status = 1;
+    }
+    return status;
+}
+
 /**
  * @brief Validates if the input is a valid integer.
  *
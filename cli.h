@@ -0,0 +1,84 @@
+#ifndef CLI_H
+#define CLI_H
+
+#include <stddef.h>
+#include <stdio.h>
+#include "crypto.h"
+
+/** Run the `crypto_1` command-line interface with the given arguments, returning the
+  * process exit status. See cli.c for the accepted forms.
+  */
+int cli(int argc, char ** argv);
+
+/** Validate a command-line operation name ("caesar-encrypt", "caesar-decrypt",
+  * "vigenere-encrypt" or "vigenere-decrypt") and key, and initialise `ctx` for them.
+  * The key must be an integer in [0, 25] for Caesar, or a non-empty string of
+  * characters 'A' to 'Z' for Vigenere.
+  *
+  * \return 0 on success, or 1 with a one-line description of the problem written to
+  *         `error` (at most `error_size` bytes, including the terminator).
+  */
+int prepare_cipher(const char * operation, const char * key_text, cipher_ctx * ctx,
+                   char * error, size_t error_size);
+
+/** A bounded cache of prepared cipher contexts, keyed by (operation, key text).
+  *
+  * Validating a key and building its shift table is done once per distinct key; later
+  * jobs with the same key reuse the prepared context. The cache is direct-mapped: each
+  * (operation, key) pair hashes to one slot, and a new pair evicts whatever occupied its
+  * slot, so memory use is bounded by the capacity. Invalid keys are cached too, with
+  * their error message. A cache must only be used by one thread at a time.
+  */
+typedef struct key_cache key_cache;
+
+/** Create a key cache with room for `capacity` prepared keys.
+  *
+  * \return The new cache, or NULL if memory could not be allocated.
+  */
+key_cache * key_cache_new(size_t capacity);
+
+/** Look up (or prepare and insert) the context for `operation` and `key_text`, rewound
+  * to the start of a message. The context stays valid until the next call on `cache`.
+  *
+  * \return The context, or NULL if the operation or key is invalid, in which case
+  *         `*error` points to a description of the problem.
+  */
+cipher_ctx * key_cache_get(key_cache * cache, const char * operation, const char * key_text,
+                           const char ** error);
+
+/** Free a key cache and wipe all the keys it holds. */
+void key_cache_free(key_cache * cache);
+
+/** Record formats accepted by `run_batch`. */
+typedef enum {
+  BATCH_LINES,    // "<operation> <key> <message>\n" -> "<result>\n"
+  BATCH_LENGTH,   // "<operation> <key> <length>\n<bytes>" -> "OK <length>\n<bytes>"
+} batch_format;
+
+/** Run every job read from `in` and write the results to `out`, in the same order.
+  *
+  * In `BATCH_LINES` format each line is one job: the operation, a space, the key, a
+  * space, and the rest of the line is the message. A failed job produces an empty
+  * output line and a diagnostic on standard error.
+  *
+  * In `BATCH_LENGTH` format each job is a header line giving the operation, key and
+  * message length, followed by exactly that many bytes of message, which may contain
+  * any byte values. Each result is `OK <length>\n` followed by the transformed bytes, or
+  * `ERR <length>\n` followed by an error message.
+  *
+  * \return 0 if every job succeeded, 1 otherwise.
+  */
+int run_batch(FILE * in, FILE * out, batch_format format);
+
+/** Serve encryption requests on the Unix domain socket `socket_path` with `threads`
+  * worker threads until the process receives SIGINT or SIGTERM. The wire protocol is
+  * described in serve.c.
+  *
+  * \return 0 after a clean shutdown, or 1 if the server could not be started.
+  */
+int run_server(const char * socket_path, int threads);
+
+
+#endif
+// CLI_H
+// vim: tw=90 :
@@ -11,43 +11,706 @@
  * @bug No known bugs.
  */
 
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <pthread.h>
 #include "crypto.h"
 
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CRYPTO_X86 1
+#endif
+
+/**
+ * @brief Signature shared by the Caesar kernels.
+ *
+ * A kernel shifts every byte of `input` in [range_low, range_low + range_size) forward
+ * by `key` positions (modulo range_size), copies all other bytes, and writes the
+ * result to `output`, which may alias `input`. `key` must already be normalised into
+ * [0, range_size).
+ */
+typedef void (*caesar_kernel_fn)(const char *input, char *output, size_t len,
+                                 char range_low, int range_size, int key);
+
+/**
+ * @brief Signature shared by the Vigenere kernels.
+ *
+ * A kernel shifts each in-range byte of `input` forward by `shifts[key_index]`, where
+ * key_index starts at the given value and advances (modulo `period`) after every
+ * in-range byte, and copies all other bytes. It returns the key index to continue from.
+ * `shifts` must hold period + VIGENERE_MIN_PERIOD entries, repeating the key's shifts,
+ * and `period` must be a multiple of the key length no smaller than VIGENERE_MIN_PERIOD.
+ */
+typedef size_t (*vigenere_kernel_fn)(const char *input, char *output, size_t len,
+                                     char range_low, int range_size,
+                                     const unsigned char *shifts, size_t period, size_t key_index);
+
+/**
+ * @brief Signature shared by the counting kernels, which return the number of bytes of
+ * `input` in [range_low, range_low + range_size).
+ */
+typedef size_t (*count_kernel_fn)(const char *input, size_t len, char range_low, int range_size);
+
+/** The widest block any kernel consumes; the period of a Vigenere shift table is at least this. */
+#define VIGENERE_MIN_PERIOD 32
+
+/**
+ * @brief Reference Caesar kernel: one byte at a time.
+ *
+ * Every vector kernel finishes its tail with this loop, and it is the kernel used when
+ * no vector unit is available or when CRYPTO_KERNEL=scalar is set.
+ */
+static void caesar_kernel_scalar(const char *input, char *output, size_t len,
+                                 char range_low, int range_size, int key) {
+    const unsigned char *in = (const unsigned char *)input;
+    unsigned char *out = (unsigned char *)output;
+    unsigned char low = (unsigned char)range_low;
+    for (size_t i = 0; i < len; i++) {
+        unsigned offset = (unsigned char)(in[i] - low);
+        if (offset < (unsigned)range_size) {
+            offset += key;
+            if (offset >= (unsigned)range_size) {
+                offset -= range_size;
+            }
+            out[i] = (unsigned char)(offset + low);
+        } else {
+            out[i] = in[i];
+        }
+    }
+}
+
+/**
+ * @brief Reference Vigenere kernel: one byte at a time.
+ *
+ * Used for the tail of every vector kernel, for ranges wider than 128 characters, and
+ * whenever CRYPTO_KERNEL=scalar is set.
+ */
+static size_t vigenere_kernel_scalar(const char *input, char *output, size_t len,
+                                     char range_low, int range_size,
+                                     const unsigned char *shifts, size_t period, size_t key_index) {
+    const unsigned char *in = (const unsigned char *)input;
+    unsigned char *out = (unsigned char *)output;
+    unsigned char low = (unsigned char)range_low;
+    for (size_t i = 0; i < len; i++) {
+        unsigned offset = (unsigned char)(in[i] - low);
+        if (offset < (unsigned)range_size) {
+            offset += shifts[key_index];
+            if (offset >= (unsigned)range_size) {
+                offset -= range_size;
+            }
+            out[i] = (unsigned char)(offset + low);
+            if (++key_index == period) {
+                key_index = 0;
+            }
+        } else {
+            out[i] = in[i];
+        }
+    }
+    return key_index;
+}
+
+/**
+ * @brief Reference counting kernel: one byte at a time.
+ */
+static size_t count_kernel_scalar(const char *input, size_t len, char range_low, int range_size) {
+    const unsigned char *in = (const unsigned char *)input;
+    unsigned char low = (unsigned char)range_low;
+    size_t count = 0;
+    for (size_t i = 0; i < len; i++) {
+        count += (unsigned char)(in[i] - low) < (unsigned)range_size;
+    }
+    return count;
+}
+
+#ifdef CRYPTO_X86
+/**
+ * @brief SSE2 counting kernel: popcount of the in-range mask, 16 bytes at a time.
+ */
+static size_t count_kernel_sse2(const char *input, size_t len, char range_low, int range_size) {
+    const __m128i low = _mm_set1_epi8(range_low);
+    const __m128i width = _mm_set1_epi8((char)(range_size - 1));
+    size_t count = 0;
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i d = _mm_sub_epi8(_mm_loadu_si128((const __m128i *)(input + i)), low);
+        __m128i in_range = _mm_cmpeq_epi8(_mm_min_epu8(d, width), d);
+        count += __builtin_popcount((unsigned)_mm_movemask_epi8(in_range));
+    }
+    return count + count_kernel_scalar(input + i, len - i, range_low, range_size);
+}
+
+/**
+ * @brief AVX2 counting kernel: popcount of the in-range mask, 32 bytes at a time.
+ */
+__attribute__((target("avx2,popcnt")))
+static size_t count_kernel_avx2(const char *input, size_t len, char range_low, int range_size) {
+    const __m256i low = _mm256_set1_epi8(range_low);
+    const __m256i width = _mm256_set1_epi8((char)(range_size - 1));
+    size_t count = 0;
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m256i d = _mm256_sub_epi8(_mm256_loadu_si256((const __m256i *)(input + i)), low);
+        __m256i in_range = _mm256_cmpeq_epi8(_mm256_min_epu8(d, width), d);
+        count += __builtin_popcount((unsigned)_mm256_movemask_epi8(in_range));
+    }
+    _mm256_zeroupper();     // the SSE2 tail is legacy-encoded; avoid the transition penalty
+    return count + count_kernel_sse2(input + i, len - i, range_low, range_size);
+}
+
 /**
- * @brief Encrypts text using the Caesar cipher.
+ * @brief SSE2 Caesar kernel: 16 bytes per iteration.
+ *
+ * Works on offsets from range_low in wrapping 8-bit arithmetic. A lane is in range when
+ * its offset is at most range_size - 1 (unsigned), and it wraps when its offset is at
+ * least range_size - key. Both tests are done with unsigned min/max and an equality
+ * compare, since SSE2 has no unsigned byte comparison. Requires range_size <= 128 so
+ * that offset + key cannot overflow a byte.
+ */
+static void caesar_kernel_sse2(const char *input, char *output, size_t len,
+                               char range_low, int range_size, int key) {
+    const __m128i low = _mm_set1_epi8(range_low);
+    const __m128i width = _mm_set1_epi8((char)(range_size - 1));
+    const __m128i shift = _mm_set1_epi8((char)key);
+    const __m128i wrap_at = _mm_set1_epi8((char)(range_size - key));
+    const __m128i size = _mm_set1_epi8((char)range_size);
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i *)(input + i));
+        __m128i d = _mm_sub_epi8(x, low);
+        __m128i in_range = _mm_cmpeq_epi8(_mm_min_epu8(d, width), d);
+        __m128i wraps = _mm_cmpeq_epi8(_mm_max_epu8(d, wrap_at), d);
+        __m128i r = _mm_sub_epi8(_mm_add_epi8(d, shift), _mm_and_si128(wraps, size));
+        r = _mm_add_epi8(r, low);
+        r = _mm_or_si128(_mm_and_si128(in_range, r), _mm_andnot_si128(in_range, x));
+        _mm_storeu_si128((__m128i *)(output + i), r);
+    }
+    caesar_kernel_scalar(input + i, output + i, len - i, range_low, range_size, key);
+}
+
+/**
+ * @brief AVX2 Caesar kernel: 32 bytes per iteration.
+ *
+ * The same computation as caesar_kernel_sse2 on 256-bit vectors. Compiled for AVX2 via
+ * a target attribute so the rest of the file keeps the baseline instruction set; it is
+ * only called after the CPU has been checked for AVX2 support.
+ */
+__attribute__((target("avx2")))
+static void caesar_kernel_avx2(const char *input, char *output, size_t len,
+                               char range_low, int range_size, int key) {
+    const __m256i low = _mm256_set1_epi8(range_low);
+    const __m256i width = _mm256_set1_epi8((char)(range_size - 1));
+    const __m256i shift = _mm256_set1_epi8((char)key);
+    const __m256i wrap_at = _mm256_set1_epi8((char)(range_size - key));
+    const __m256i size = _mm256_set1_epi8((char)range_size);
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m256i x = _mm256_loadu_si256((const __m256i *)(input + i));
+        __m256i d = _mm256_sub_epi8(x, low);
+        __m256i in_range = _mm256_cmpeq_epi8(_mm256_min_epu8(d, width), d);
+        __m256i wraps = _mm256_cmpeq_epi8(_mm256_max_epu8(d, wrap_at), d);
+        __m256i r = _mm256_sub_epi8(_mm256_add_epi8(d, shift), _mm256_and_si256(wraps, size));
+        r = _mm256_add_epi8(r, low);
+        r = _mm256_blendv_epi8(x, r, in_range);
+        _mm256_storeu_si256((__m256i *)(output + i), r);
+    }
+    _mm256_zeroupper();
+    caesar_kernel_sse2(input + i, output + i, len - i, range_low, range_size, key);
+}
+
+/**
+ * @brief SSSE3 Vigenere kernel: 16 bytes per iteration.
+ *
+ * The key only advances on in-range bytes, so the key position of each lane depends on
+ * the lanes before it. Instead of walking that chain, each block computes its in-range
+ * mask, turns it into an exclusive prefix count (the number of in-range lanes before
+ * each lane) with four shift-and-add steps, and uses those counts as pshufb indices into
+ * the 16 shifts starting at the current key index. The key index then advances by the
+ * popcount of the mask. The per-lane add and wrap are as in caesar_kernel_sse2.
+ */
+__attribute__((target("ssse3")))
+static size_t vigenere_kernel_ssse3(const char *input, char *output, size_t len,
+                                    char range_low, int range_size,
+                                    const unsigned char *shifts, size_t period, size_t key_index) {
+    const __m128i low = _mm_set1_epi8(range_low);
+    const __m128i width = _mm_set1_epi8((char)(range_size - 1));
+    const __m128i size = _mm_set1_epi8((char)range_size);
+    const __m128i one = _mm_set1_epi8(1);
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i *)(input + i));
+        __m128i d = _mm_sub_epi8(x, low);
+        __m128i in_range = _mm_cmpeq_epi8(_mm_min_epu8(d, width), d);
+
+        __m128i ones = _mm_and_si128(in_range, one);
+        __m128i before = _mm_add_epi8(ones, _mm_slli_si128(ones, 1));
+        before = _mm_add_epi8(before, _mm_slli_si128(before, 2));
+        before = _mm_add_epi8(before, _mm_slli_si128(before, 4));
+        before = _mm_add_epi8(before, _mm_slli_si128(before, 8));
+        before = _mm_sub_epi8(before, ones);
+
+        __m128i keys = _mm_loadu_si128((const __m128i *)(shifts + key_index));
+        __m128i r = _mm_add_epi8(d, _mm_shuffle_epi8(keys, before));
+        __m128i wraps = _mm_cmpeq_epi8(_mm_max_epu8(r, size), r);
+        r = _mm_add_epi8(_mm_sub_epi8(r, _mm_and_si128(wraps, size)), low);
+        r = _mm_or_si128(_mm_and_si128(in_range, r), _mm_andnot_si128(in_range, x));
+        _mm_storeu_si128((__m128i *)(output + i), r);
+
+        key_index += __builtin_popcount((unsigned)_mm_movemask_epi8(in_range));
+        if (key_index >= period) {
+            key_index -= period;
+        }
+    }
+    return vigenere_kernel_scalar(input + i, output + i, len - i, range_low, range_size,
+                                  shifts, period, key_index);
+}
+
+/**
+ * @brief AVX2 Vigenere kernel: 32 bytes per iteration.
+ *
+ * AVX2 byte shifts and shuffles act on each 128-bit half separately, which suits the
+ * SSSE3 scheme: each half gets its own prefix counts and its own 16 shifts, the upper
+ * half's starting at the key index advanced by the lower half's popcount.
+ */
+__attribute__((target("avx2,popcnt")))
+static size_t vigenere_kernel_avx2(const char *input, char *output, size_t len,
+                                   char range_low, int range_size,
+                                   const unsigned char *shifts, size_t period, size_t key_index) {
+    const __m256i low = _mm256_set1_epi8(range_low);
+    const __m256i width = _mm256_set1_epi8((char)(range_size - 1));
+    const __m256i size = _mm256_set1_epi8((char)range_size);
+    const __m256i one = _mm256_set1_epi8(1);
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m256i x = _mm256_loadu_si256((const __m256i *)(input + i));
+        __m256i d = _mm256_sub_epi8(x, low);
+        __m256i in_range = _mm256_cmpeq_epi8(_mm256_min_epu8(d, width), d);
+        unsigned mask = (unsigned)_mm256_movemask_epi8(in_range);
+
+        __m256i ones = _mm256_and_si256(in_range, one);
+        __m256i before = _mm256_add_epi8(ones, _mm256_slli_si256(ones, 1));
+        before = _mm256_add_epi8(before, _mm256_slli_si256(before, 2));
+        before = _mm256_add_epi8(before, _mm256_slli_si256(before, 4));
+        before = _mm256_add_epi8(before, _mm256_slli_si256(before, 8));
+        before = _mm256_sub_epi8(before, ones);
+
+        size_t upper_index = key_index + __builtin_popcount(mask & 0xFFFFu);
+        if (upper_index >= period) {
+            upper_index -= period;
+        }
+        __m256i keys = _mm256_inserti128_si256(
+            _mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)(shifts + key_index))),
+            _mm_loadu_si128((const __m128i *)(shifts + upper_index)), 1);
+        __m256i r = _mm256_add_epi8(d, _mm256_shuffle_epi8(keys, before));
+        __m256i wraps = _mm256_cmpeq_epi8(_mm256_max_epu8(r, size), r);
+        r = _mm256_add_epi8(_mm256_sub_epi8(r, _mm256_and_si256(wraps, size)), low);
+        r = _mm256_blendv_epi8(x, r, in_range);
+        _mm256_storeu_si256((__m256i *)(output + i), r);
+
+        key_index = upper_index + __builtin_popcount(mask >> 16);
+        if (key_index >= period) {
+            key_index -= period;
+        }
+    }
+    _mm256_zeroupper();
+    return vigenere_kernel_ssse3(input + i, output + i, len - i, range_low, range_size,
+                                 shifts, period, key_index);
+}
+#endif
+
+/** The kernels known to this build, best first. */
+static const struct {
+    const char *name;
+    caesar_kernel_fn caesar;
+    vigenere_kernel_fn vigenere;
+    count_kernel_fn count;
+} crypto_kernels[] = {
+#ifdef CRYPTO_X86
+    { "avx2", caesar_kernel_avx2, vigenere_kernel_avx2, count_kernel_avx2 },
+    { "ssse3", caesar_kernel_sse2, vigenere_kernel_ssse3, count_kernel_sse2 },
+    { "sse2", caesar_kernel_sse2, vigenere_kernel_scalar, count_kernel_sse2 },
+#endif
+    { "scalar", caesar_kernel_scalar, vigenere_kernel_scalar, count_kernel_scalar },
+};
+
+#define CRYPTO_KERNEL_COUNT (sizeof(crypto_kernels) / sizeof(crypto_kernels[0]))
+
+/** Index into crypto_kernels of the kernel in use; chosen by crypto_select_kernel. */
+static size_t crypto_kernel = CRYPTO_KERNEL_COUNT - 1;
+
+/**
+ * @brief Reports whether the running CPU can execute a kernel.
+ *
+ * @param index Index into crypto_kernels.
+ * @return Non-zero if the kernel is usable.
+ */
+static int crypto_kernel_supported(size_t index) {
+#ifdef CRYPTO_X86
+    if (strcmp(crypto_kernels[index].name, "avx2") == 0) {
+        return __builtin_cpu_supports("avx2");
+    }
+    if (strcmp(crypto_kernels[index].name, "ssse3") == 0) {
+        return __builtin_cpu_supports("ssse3");
+    }
+    if (strcmp(crypto_kernels[index].name, "sse2") == 0) {
+        return __builtin_cpu_supports("sse2");
+    }
+#endif
+    return strcmp(crypto_kernels[index].name, "scalar") == 0;
+}
+
+/**
+ * @brief Selects a cipher kernel by name.
+ *
+ * @param name "avx2", "ssse3", "sse2" or "scalar".
+ * @return 0 on success, -1 if the kernel is unknown or not supported by this CPU.
+ */
+int crypto_set_kernel(const char *name) {
+    assert(name != NULL);
+    for (size_t i = 0; i < CRYPTO_KERNEL_COUNT; i++) {
+        if (strcmp(crypto_kernels[i].name, name) == 0 && crypto_kernel_supported(i)) {
+            crypto_kernel = i;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Returns the name of the cipher kernel in use.
+ */
+const char *crypto_kernel_name(void) {
+    return crypto_kernels[crypto_kernel].name;
+}
+
+/**
+ * @brief Picks the best supported kernel when the program starts.
+ *
+ * The CRYPTO_KERNEL environment variable, if set to a supported kernel name, overrides
+ * the automatic choice; this is how the differential tests run the same input through
+ * every kernel.
+ */
+__attribute__((constructor))
+static void crypto_select_kernel(void) {
+#ifdef CRYPTO_X86
+    __builtin_cpu_init();
+#endif
+    const char *forced = getenv("CRYPTO_KERNEL");
+    if (forced != NULL && crypto_set_kernel(forced) == 0) {
+        return;
+    }
+    for (size_t i = 0; i < CRYPTO_KERNEL_COUNT; i++) {
+        if (crypto_kernel_supported(i)) {
+            crypto_kernel = i;
+            return;
+        }
+    }
+}
+
+/**
+ * @brief Runs the selected Caesar kernel, falling back to the table for wide ranges.
+ *
+ * @param range_low The lower bound of the character range.
+ * @param range_high The upper bound of the character range.
+ * @param key The shift; may be negative or larger than the range.
+ * @param input The input bytes.
+ * @param output The output buffer; may be the same as input.
+ * @param len The number of bytes to transform.
+ *
+ * The vector kernels need offset + key to fit in a byte, so ranges wider than 128
+ * characters always use a caesar_table.
+ */
+static void caesar_shift(char range_low, char range_high, int key, const char *input, char *output, size_t len) {
+    int range_size = range_high - range_low + 1;
+    if (range_size > 128) {
+        caesar_table table;
+        caesar_table_init(&table, range_low, range_high, key);
+        caesar_table_apply(&table, input, output, len);
+        return;
+    }
+    key = (key % range_size + range_size) % range_size;
+    crypto_kernels[crypto_kernel].caesar(input, output, len, range_low, range_size, key);
+}
+
+/** Keys up to this length are expanded on the stack by the one-shot Vigenere functions. */
+#define VIGENERE_STACK_KEY 256
+
+/**
+ * @brief Returns the period used to index a shift table for a key of the given length.
+ *
+ * The smallest multiple of key_len that is at least VIGENERE_MIN_PERIOD, so that a
+ * kernel block never advances the key index by more than one period.
+ */
+static size_t vigenere_period(size_t key_len) {
+    return key_len * ((VIGENERE_MIN_PERIOD + key_len - 1) / key_len);
+}
+
+/**
+ * @brief Returns the number of bytes in the shift table for a key of the given length.
+ *
+ * One period, plus enough repeated entries for a kernel to load a full block of
+ * shifts starting from any key index within the period.
+ */
+static size_t vigenere_shifts_size(size_t key_len) {
+    return vigenere_period(key_len) + VIGENERE_MIN_PERIOD;
+}
+
+/**
+ * @brief Overwrites key material so it does not linger in memory.
+ *
+ * @param buffer The bytes to clear.
+ * @param len The number of bytes.
+ *
+ * The writes go through a volatile pointer so they are not optimised away.
+ */
+static void wipe(void *buffer, size_t len) {
+    volatile unsigned char *p = buffer;
+    for (size_t i = 0; i < len; i++) {
+        p[i] = 0;
+    }
+}
+
+/**
+ * @brief Records the range and shift table of a cipher context.
+ *
+ * @param ctx The context to initialise.
+ * @param range_low The lower bound of the character range.
+ * @param range_high The upper bound of the character range.
+ * @param key_len The number of key positions.
+ * @param shifts A buffer of vigenere_shifts_size(key_len) bytes, or NULL to allocate one.
+ * @return 0 on success, -1 if the shift table could not be allocated.
+ */
+static int cipher_ctx_setup(cipher_ctx *ctx, char range_low, char range_high, size_t key_len, unsigned char *shifts) {
+    assert(ctx != NULL);
+    assert(range_high > range_low);
+    assert(key_len > 0);
+    ctx->range_low = range_low;
+    ctx->range_high = range_high;
+    ctx->range_size = range_high - range_low + 1;
+    ctx->key_len = key_len;
+    ctx->period = vigenere_period(key_len);
+    ctx->key_index = 0;
+    ctx->shifts = shifts != NULL ? shifts : malloc(vigenere_shifts_size(key_len));
+    return ctx->shifts == NULL ? -1 : 0;
+}
+
+/**
+ * @brief Returns the shift a key character applies within a range.
+ *
+ * @param key_char The key character; its offset within the range is taken modulo the range size.
+ * @param range_low The lower bound of the character range.
+ * @param range_size The number of characters in the range.
+ * @param decrypt Non-zero for the inverse shift, for decryption.
+ * @return The shift, from 0 to range_size - 1.
+ */
+static int vigenere_key_shift(char key_char, char range_low, int range_size, int decrypt) {
+    int key_offset = key_char - range_low;
+    if (key_offset < 0 || key_offset >= range_size) {      // divide only for out-of-range keys
+        key_offset = (key_offset % range_size + range_size) % range_size;
+    }
+    if (decrypt && key_offset != 0) {
+        key_offset = range_size - key_offset;
+    }
+    return key_offset;
+}
+
+/**
+ * @brief Fills the shift table of a context from a key.
+ *
+ * @param ctx A context set up by cipher_ctx_setup.
+ * @param key The key; each character is converted to its offset within the range.
+ * @param decrypt Non-zero to store the inverse shifts for decryption.
+ *
+ * The first key_len entries are computed and the rest of the table repeats them.
+ */
+static void vigenere_fill_shifts(cipher_ctx *ctx, const char *key, int decrypt) {
+    for (size_t i = 0; i < ctx->key_len; i++) {
+        ctx->shifts[i] = (unsigned char)vigenere_key_shift(key[i], ctx->range_low, ctx->range_size, decrypt);
+    }
+    size_t size = vigenere_shifts_size(ctx->key_len);
+    for (size_t i = ctx->key_len; i < size; i++) {
+        ctx->shifts[i] = ctx->shifts[i - ctx->key_len];
+    }
+}
+
+/**
+ * @brief Runs the selected Vigenere kernel over a buffer, continuing from ctx's key index.
+ *
+ * @param ctx The prepared context.
+ * @param input The input bytes.
+ * @param output The output buffer; may be the same as input.
+ * @param len The number of bytes to transform.
+ */
+static void vigenere_run(cipher_ctx *ctx, const char *input, char *output, size_t len) {
+    vigenere_kernel_fn kernel = ctx->range_size > 128 ? vigenere_kernel_scalar
+                                                      : crypto_kernels[crypto_kernel].vigenere;
+    size_t key_index = kernel(input, output, len, ctx->range_low, ctx->range_size,
+                              ctx->shifts, ctx->period, ctx->key_index);
+    ctx->key_index = key_index % ctx->key_len;
+}
+
+/**
+ * @brief Reference Vigenere implementation that works directly from the key string.
+ *
+ * @param range_low The lower bound of the character range.
+ * @param range_high The upper bound of the character range.
+ * @param key The key.
+ * @param input The input bytes.
+ * @param output The output buffer; may be the same as input.
+ * @param len The number of bytes to transform.
+ * @param decrypt Non-zero to decrypt.
+ *
+ * Only used when a very long key's shift table cannot be allocated.
+ */
+static void vigenere_reference(char range_low, char range_high, const char *key, const char *input, char *output, size_t len, int decrypt) {
+    size_t key_len = strlen(key);
+    int range_size = range_high - range_low + 1;
+    for (size_t i = 0, key_index = 0; i < len; i++) {
+        if (input[i] >= range_low && input[i] <= range_high) {
+            int offset = input[i] - range_low;
+            int key_offset = vigenere_key_shift(key[key_index % key_len], range_low, range_size, decrypt);
+            output[i] = (offset + key_offset) % range_size + range_low;
+            key_index++;
+        } else {
+            output[i] = input[i];
+        }
+    }
+}
+
+/**
+ * @brief One-shot Vigenere transform shared by vigenere_encrypt_n and vigenere_decrypt_n.
+ *
+ * @param range_low The lower bound of the character range.
+ * @param range_high The upper bound of the character range.
+ * @param key The key.
+ * @param input The input bytes.
+ * @param output The output buffer; may be the same as input.
+ * @param len The number of bytes to transform.
+ * @param decrypt Non-zero to decrypt.
+ *
+ * The shift table lives on the stack for keys up to VIGENERE_STACK_KEY characters, so
+ * the common case makes no heap allocation.
+ */
+static void vigenere_apply(char range_low, char range_high, const char *key, const char *input, char *output, size_t len, int decrypt) {
+    assert(key != NULL && key[0] != '\0');
+    assert(range_high > range_low);
+    size_t key_len = strlen(key);
+    unsigned char stack_shifts[VIGENERE_STACK_KEY + 2 * VIGENERE_MIN_PERIOD];
+    cipher_ctx ctx;
+
+    if (key_len <= VIGENERE_STACK_KEY) {
+        cipher_ctx_setup(&ctx, range_low, range_high, key_len, stack_shifts);
+        vigenere_fill_shifts(&ctx, key, decrypt);
+        vigenere_run(&ctx, input, output, len);
+        wipe(stack_shifts, vigenere_shifts_size(key_len));
+    } else if (cipher_ctx_setup(&ctx, range_low, range_high, key_len, NULL) == 0) {
+        vigenere_fill_shifts(&ctx, key, decrypt);
+        vigenere_run(&ctx, input, output, len);
+        cipher_final(&ctx);
+    } else {
+        vigenere_reference(range_low, range_high, key, input, output, len, decrypt);
+    }
+}
+
+/**
+ * @brief Adds a shifted character range to a Caesar translation table.
+ *
+ * @param table The table to modify.
+ * @param range_low The lower bound of the character range.
+ * @param range_high The upper bound of the character range.
+ * @param key The shift to apply within the range; may be negative.
+ */
+void caesar_table_add_range(caesar_table *table, char range_low, char range_high, int key) {
+    assert(table != NULL);
+    assert(range_high > range_low);
+    int range_size = range_high - range_low + 1;
+
+    // Normalize key to be within the valid range
+    key = (key % range_size + range_size) % range_size;
+    assert(key >= 0 && key < range_size);
+
+    for (int offset = 0; offset < range_size; offset++) {
+        char from = (char)(range_low + offset);
+        char to = (char)(range_low + (offset + key) % range_size);
+        table->map[(unsigned char)from] = (unsigned char)to;
+    }
+}
+
+/**
+ * @brief Builds a Caesar translation table for a single character range.
+ *
+ * @param table The table to initialise.
+ * @param range_low The lower bound of the character range.
+ * @param range_high The upper bound of the character range.
+ * @param key The shift to apply within the range; may be negative.
+ *
+ * Bytes outside the range map to themselves.
+ */
+void caesar_table_init(caesar_table *table, char range_low, char range_high, int key) {
+    assert(table != NULL);
+    for (int c = 0; c < 256; c++) {
+        table->map[c] = (unsigned char)c;
+    }
+    caesar_table_add_range(table, range_low, range_high, key);
+}
+
+/**
+ * @brief Applies a Caesar translation table to a buffer.
+ *
+ * @param table The translation table.
+ * @param input The input bytes.
+ * @param output The output buffer; may be the same as input.
+ * @param len The number of bytes to transform.
+ */
+void caesar_table_apply(const caesar_table *table, const char *input, char *output, size_t len) {
+    assert(table != NULL);
+    assert(len == 0 || (input != NULL && output != NULL));
+    const unsigned char *in = (const unsigned char *)input;
+    unsigned char *out = (unsigned char *)output;
+    for (size_t i = 0; i < len; i++) {
+        out[i] = table->map[in[i]];
+    }
+}
+
+/**
+ * @brief Encrypts a buffer of known length using the Caesar cipher.
  * 
  * @param range_low The lower bound of the character range.
  * @param range_high The upper bound of the character range.
  * @param key The encryption key.
  * @param plain_text The input plain text.
- * @param cipher_text The output cipher text.
+ * @param cipher_text The output cipher text; may be the same buffer as plain_text.
+ * @param len The number of bytes to encrypt.
  * 
  * The Caesar cipher shifts each character in the plain text by a fixed number of
  * positions defined by the key. The character range is specified by range_low and range_high.
- * The function assumes the input text contains characters within the specified range.
+ * The work is done by the fastest kernel the CPU supports (see crypto_set_kernel).
+ */
+void caesar_encrypt_n(char range_low, char range_high, int key, const char *plain_text, char *cipher_text, size_t len) {
+    assert(len == 0 || (plain_text != NULL && cipher_text != NULL));
+    assert(range_high > range_low);
+    caesar_shift(range_low, range_high, key, plain_text, cipher_text, len);
+}
+
+/**
+ * @brief Encrypts a null-terminated string using the Caesar cipher.
+ *
+ * @param range_low The lower bound of the character range.
+ * @param range_high The upper bound of the character range.
+ * @param key The encryption key.
+ * @param plain_text The input plain text.
+ * @param cipher_text The output cipher text.
+ *
+ * Equivalent to caesar_encrypt_n over strlen(plain_text) bytes, followed by a
+ * terminating null character.
  */
 void caesar_encrypt(char range_low, char range_high, int key, const char *plain_text, char *cipher_text) {
     assert(plain_text != NULL && cipher_text != NULL);
-    assert(range_high > range_low);
     size_t len = strlen(plain_text);
-    int range_size = range_high - range_low + 1;
-    
-    // Normalize key to be within the valid range
-    key = (key % range_size + range_size) % range_size;
-    assert(key >= 0 && key < range_size);
-    
-    for (size_t i = 0; i < len; i++) {
-        if (plain_text[i] >= range_low && plain_text[i] <= range_high) {
-            int offset = plain_text[i] - range_low;
-            cipher_text[i] = (offset + key) % range_size + range_low;
-        } else {
-            cipher_text[i] = plain_text[i];
-        }
-    }
+    caesar_encrypt_n(range_low, range_high, key, plain_text, cipher_text, len);
     cipher_text[len] = '\0';
 }
 
@@ -68,69 +731,342 @@ void caesar_decrypt(char range_low, char range_high, int key, const char *cipher
 }
 
 /**
- * @brief Encrypts text using the Vigenere cipher.
+ * @brief Decrypts a buffer of known length using the Caesar cipher.
+ *
+ * @param range_low The lower bound of the character range.
+ * @param range_high The upper bound of the character range.
+ * @param key The decryption key.
+ * @param cipher_text The input cipher text.
+ * @param plain_text The output plain text; may be the same buffer as cipher_text.
+ * @param len The number of bytes to decrypt.
+ */
+void caesar_decrypt_n(char range_low, char range_high, int key, const char *cipher_text, char *plain_text, size_t len) {
+    caesar_encrypt_n(range_low, range_high, -key, cipher_text, plain_text, len);
+}
+
+/**
+ * @brief Encrypts a buffer of known length using the Vigenere cipher.
  * 
  * @param range_low The lower bound of the character range.
  * @param range_high The upper bound of the character range.
  * @param key The encryption key.
  * @param plain_text The input plain text.
- * @param cipher_text The output cipher text.
+ * @param cipher_text The output cipher text; may be the same buffer as plain_text.
+ * @param len The number of bytes to encrypt.
  * 
  * The Vigenere cipher uses a keyword to encrypt the text. Each character in the plain text
  * is shifted by a number of positions defined by the corresponding character in the key.
- * The character range is specified by range_low and range_high. The function assumes the input text
- * contains characters within the specified range.
+ * The character range is specified by range_low and range_high. Characters outside the range
+ * are copied unchanged and do not advance the key. The work is done by the fastest kernel
+ * the CPU supports (see crypto_set_kernel).
+ */
+void vigenere_encrypt_n(char range_low, char range_high, const char *key, const char *plain_text, char *cipher_text, size_t len) {
+    assert(len == 0 || (plain_text != NULL && cipher_text != NULL));
+    vigenere_apply(range_low, range_high, key, plain_text, cipher_text, len, 0);
+}
+
+/**
+ * @brief Encrypts a null-terminated string using the Vigenere cipher.
+ *
+ * @param range_low The lower bound of the character range.
+ * @param range_high The upper bound of the character range.
+ * @param key The encryption key.
+ * @param plain_text The input plain text.
+ * @param cipher_text The output cipher text.
+ *
+ * Equivalent to vigenere_encrypt_n over strlen(plain_text) bytes, followed by a
+ * terminating null character.
  */
 void vigenere_encrypt(char range_low, char range_high, const char *key, const char *plain_text, char *cipher_text) {
     assert(plain_text != NULL && cipher_text != NULL);
-    assert(key != NULL && key[0] != '\0');
-    assert(range_high > range_low);
     size_t len = strlen(plain_text);
-    size_t key_len = strlen(key);
-    int range_size = range_high - range_low + 1;
-    for (size_t i = 0, key_index = 0; i < len; i++) {
-        if (plain_text[i] >= range_low && plain_text[i] <= range_high) {
-            int plain_offset = plain_text[i] - range_low;
-            int key_offset = key[key_index % key_len] - range_low;
-            cipher_text[i] = (plain_offset + key_offset) % range_size + range_low;
-            key_index++;
-        } else {
-            cipher_text[i] = plain_text[i];
-        }
-    }
+    vigenere_encrypt_n(range_low, range_high, key, plain_text, cipher_text, len);
     cipher_text[len] = '\0';
 }
 
 /**
- * @brief Decrypts text using the Vigenere cipher.
+ * @brief Decrypts a buffer of known length using the Vigenere cipher.
  * 
  * @param range_low The lower bound of the character range.
  * @param range_high The upper bound of the character range.
  * @param key The decryption key.
  * @param cipher_text The input cipher text.
- * @param plain_text The output plain text.
+ * @param plain_text The output plain text; may be the same buffer as cipher_text.
+ * @param len The number of bytes to decrypt.
  * 
  * The Vigenere cipher uses a keyword to decrypt the text. Each character in the cipher text
  * is shifted by a number of positions defined by the corresponding character in the key, in the reverse direction.
- * The character range is specified by range_low and range_high. The function assumes the input text
- * contains characters within the specified range.
+ * The character range is specified by range_low and range_high. Characters outside the range
+ * are copied unchanged and do not advance the key.
+ */
+void vigenere_decrypt_n(char range_low, char range_high, const char *key, const char *cipher_text, char *plain_text, size_t len) {
+    assert(len == 0 || (cipher_text != NULL && plain_text != NULL));
+    vigenere_apply(range_low, range_high, key, cipher_text, plain_text, len, 1);
+}
+
+/**
+ * @brief Decrypts a null-terminated string using the Vigenere cipher.
+ *
+ * @param range_low The lower bound of the character range.
+ * @param range_high The upper bound of the character range.
+ * @param key The decryption key.
+ * @param cipher_text The input cipher text.
+ * @param plain_text The output plain text.
+ *
+ * Equivalent to vigenere_decrypt_n over strlen(cipher_text) bytes, followed by a
+ * terminating null character.
  */
 void vigenere_decrypt(char range_low, char range_high, const char *key, const char *cipher_text, char *plain_text) {
     assert(cipher_text != NULL && plain_text != NULL);
-    assert(key != NULL && key[0] != '\0');
-    assert(range_high > range_low);
     size_t len = strlen(cipher_text);
-    size_t key_len = strlen(key);
-    int range_size = range_high - range_low + 1;
-    for (size_t i = 0, key_index = 0; i < len; i++) {
-        if (cipher_text[i] >= range_low && cipher_text[i] <= range_high) {
-            int cipher_offset = cipher_text[i] - range_low;
-            int key_offset = key[key_index % key_len] - range_low;
-            plain_text[i] = (cipher_offset - key_offset + range_size) % range_size + range_low;
-            key_index++;
+    vigenere_decrypt_n(range_low, range_high, key, cipher_text, plain_text, len);
+    plain_text[len] = '\0';
+}
+
+/**
+ * @brief Initialises a context for Caesar encryption.
+ *
+ * @param ctx The context to initialise.
+ * @param range_low The lower bound of the character range.
+ * @param range_high The upper bound of the character range.
+ * @param key The encryption key.
+ * @return 0 on success, -1 on allocation failure.
+ */
+int caesar_encrypt_init(cipher_ctx *ctx, char range_low, char range_high, int key) {
+    if (cipher_ctx_setup(ctx, range_low, range_high, 1, NULL) != 0) {
+        return -1;
+    }
+    int range_size = ctx->range_size;
+    memset(ctx->shifts, (key % range_size + range_size) % range_size, vigenere_shifts_size(1));
+    return 0;
+}
+
+/**
+ * @brief Initialises a context for Caesar decryption.
+ *
+ * @param ctx The context to initialise.
+ * @param range_low The lower bound of the character range.
+ * @param range_high The upper bound of the character range.
+ * @param key The decryption key.
+ * @return 0 on success, -1 on allocation failure.
+ *
+ * As with caesar_decrypt, this is encryption with the negated key.
+ */
+int caesar_decrypt_init(cipher_ctx *ctx, char range_low, char range_high, int key) {
+    return caesar_encrypt_init(ctx, range_low, range_high, -key);
+}
+
+/**
+ * @brief Initialises a context for Vigenere encryption or decryption.
+ *
+ * @param ctx The context to initialise.
+ * @param range_low The lower bound of the character range.
+ * @param range_high The upper bound of the character range.
+ * @param key The key; each character is converted to its offset within the range.
+ * @param decrypt Non-zero to store the inverse shifts for decryption.
+ * @return 0 on success, -1 on allocation failure.
+ */
+static int vigenere_init(cipher_ctx *ctx, char range_low, char range_high, const char *key, int decrypt) {
+    assert(key != NULL && key[0] != '\0');
+    if (cipher_ctx_setup(ctx, range_low, range_high, strlen(key), NULL) != 0) {
+        return -1;
+    }
+    vigenere_fill_shifts(ctx, key, decrypt);
+    return 0;
+}
+
+/**
+ * @brief Initialises a context for Vigenere encryption.
+ *
+ * @param ctx The context to initialise.
+ * @param range_low The lower bound of the character range.
+ * @param range_high The upper bound of the character range.
+ * @param key The encryption key.
+ * @return 0 on success, -1 on allocation failure.
+ */
+int vigenere_encrypt_init(cipher_ctx *ctx, char range_low, char range_high, const char *key) {
+    return vigenere_init(ctx, range_low, range_high, key, 0);
+}
+
+/**
+ * @brief Initialises a context for Vigenere decryption.
+ *
+ * @param ctx The context to initialise.
+ * @param range_low The lower bound of the character range.
+ * @param range_high The upper bound of the character range.
+ * @param key The decryption key.
+ * @return 0 on success, -1 on allocation failure.
+ */
+int vigenere_decrypt_init(cipher_ctx *ctx, char range_low, char range_high, const char *key) {
+    return vigenere_init(ctx, range_low, range_high, key, 1);
+}
+
+/**
+ * @brief Transforms the next chunk of a message.
+ *
+ * @param ctx The initialised cipher context.
+ * @param input The input bytes (not necessarily null-terminated).
+ * @param output The output buffer; may be the same as input.
+ * @param len The number of bytes to transform.
+ *
+ * The key index carries over between calls, so splitting a message into chunks does
+ * not change the result.
+ */
+void cipher_update(cipher_ctx *ctx, const char *input, char *output, size_t len) {
+    assert(ctx != NULL && ctx->shifts != NULL);
+    assert(len == 0 || (input != NULL && output != NULL));
+    if (ctx->key_len == 1) {
+        caesar_shift(ctx->range_low, ctx->range_high, ctx->shifts[0], input, output, len);
+        return;
+    }
+    vigenere_run(ctx, input, output, len);
+}
+
+/** Parallel updates give each worker at least this many bytes. */
+#define PARALLEL_MIN_CHUNK (256 * 1024)
+
+/** Upper bound on the number of worker threads in one parallel update. */
+#define PARALLEL_MAX_THREADS 256
+
+/**
+ * @brief The share of a parallel update handled by one worker thread.
+ */
+typedef struct {
+    cipher_ctx ctx;         // copy of the caller's context, with this chunk's key index
+    const char *input;
+    char *output;
+    size_t len;
+    size_t in_range;        // filled in by the counting pass
+} parallel_chunk;
+
+/**
+ * @brief Counting pass: number of in-range characters in one chunk.
+ *
+ * @param arg The parallel_chunk to count.
+ * @return NULL.
+ */
+static void *parallel_count(void *arg) {
+    parallel_chunk *chunk = arg;
+    chunk->in_range = chunk->ctx.range_size > 128
+        ? count_kernel_scalar(chunk->input, chunk->len, chunk->ctx.range_low, chunk->ctx.range_size)
+        : crypto_kernels[crypto_kernel].count(chunk->input, chunk->len, chunk->ctx.range_low,
+                                              chunk->ctx.range_size);
+    return NULL;
+}
+
+/**
+ * @brief Transform pass: encrypts or decrypts one chunk from its own key index.
+ *
+ * @param arg The parallel_chunk to transform.
+ * @return NULL.
+ */
+static void *parallel_transform(void *arg) {
+    parallel_chunk *chunk = arg;
+    cipher_update(&chunk->ctx, chunk->input, chunk->output, chunk->len);
+    return NULL;
+}
+
+/**
+ * @brief Runs one pass over all chunks, using the calling thread for the first chunk.
+ *
+ * @param chunks The chunks.
+ * @param count The number of chunks.
+ * @param pass The function to run on each chunk.
+ *
+ * If a thread cannot be created, its chunk is processed on the calling thread instead,
+ * so the pass always completes.
+ */
+static void parallel_pass(parallel_chunk *chunks, size_t count, void *(*pass)(void *)) {
+    pthread_t threads[PARALLEL_MAX_THREADS];
+    int started[PARALLEL_MAX_THREADS] = {0};
+    for (size_t t = 1; t < count; t++) {
+        started[t] = pthread_create(&threads[t], NULL, pass, &chunks[t]) == 0;
+    }
+    pass(&chunks[0]);
+    for (size_t t = 1; t < count; t++) {
+        if (started[t]) {
+            pthread_join(threads[t], NULL);
         } else {
-            plain_text[i] = cipher_text[i];
+            pass(&chunks[t]);
         }
     }
-    plain_text[len] = '\0';
+}
+
+/**
+ * @brief Transforms a large buffer using several threads.
+ *
+ * @param ctx The initialised cipher context.
+ * @param input The input bytes.
+ * @param output The output buffer; may be the same as input.
+ * @param len The number of bytes to transform.
+ * @param threads The maximum number of threads to use, including the caller.
+ *
+ * The buffer is split into equal chunks. For Vigenere, a first parallel pass counts the
+ * in-range characters in each chunk; an exclusive prefix sum of those counts gives
+ * every chunk the key index it starts at, and a second parallel pass transforms the
+ * chunks independently. Caesar needs no counting pass. The result, and the key index
+ * left in ctx, are identical to a single cipher_update call.
+ */
+void cipher_update_parallel(cipher_ctx *ctx, const char *input, char *output, size_t len, int threads) {
+    assert(ctx != NULL && ctx->shifts != NULL);
+    assert(len == 0 || (input != NULL && output != NULL));
+    size_t count = threads > 0 ? (size_t)threads : 1;
+    if (count > PARALLEL_MAX_THREADS) {
+        count = PARALLEL_MAX_THREADS;
+    }
+    if (count > len / PARALLEL_MIN_CHUNK) {
+        count = len / PARALLEL_MIN_CHUNK;
+    }
+    if (count <= 1) {
+        cipher_update(ctx, input, output, len);
+        return;
+    }
+
+    parallel_chunk chunks[PARALLEL_MAX_THREADS];
+    size_t chunk_len = len / count;
+    for (size_t t = 0; t < count; t++) {
+        chunks[t].ctx = *ctx;
+        chunks[t].input = input + t * chunk_len;
+        chunks[t].output = output + t * chunk_len;
+        chunks[t].len = t + 1 == count ? len - t * chunk_len : chunk_len;
+    }
+
+    if (ctx->key_len > 1) {
+        parallel_pass(chunks, count, parallel_count);
+        size_t key_index = ctx->key_index;
+        for (size_t t = 0; t < count; t++) {
+            chunks[t].ctx.key_index = key_index;
+            key_index = (key_index + chunks[t].in_range) % ctx->key_len;
+        }
+        ctx->key_index = key_index;
+    }
+    parallel_pass(chunks, count, parallel_transform);
+}
+
+/**
+ * @brief Rewinds a cipher context to the start of a new message.
+ *
+ * @param ctx The initialised cipher context.
+ */
+void cipher_reset(cipher_ctx *ctx) {
+    assert(ctx != NULL && ctx->shifts != NULL);
+    ctx->key_index = 0;
+}
+
+/**
+ * @brief Releases a cipher context.
+ *
+ * @param ctx The context to release.
+ *
+ * The shift table is wiped before it is freed so the key does not linger on the heap.
+ */
+void cipher_final(cipher_ctx *ctx) {
+    assert(ctx != NULL);
+    if (ctx->shifts != NULL) {
+        wipe(ctx->shifts, vigenere_shifts_size(ctx->key_len));
+        free(ctx->shifts);
+    }
+    ctx->shifts = NULL;
+    ctx->key_len = 0;
+    ctx->key_index = 0;
 }
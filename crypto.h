@@ -1,6 +1,8 @@
 #ifndef CRYPTO_H
 #define CRYPTO_H
 
+#include <stddef.h>
+
 /** Encrypt a given plaintext using the Caesar cipher, using a specified key, where the
   * characters to encrypt fall within a given range (and all other characters are copied
   * over unchanged).
@@ -47,6 +49,22 @@
   */
 void caesar_encrypt(char range_low, char range_high, int key, const char * plain_text, char * cipher_text);
 
+/** Length-explicit form of `caesar_encrypt`.
+  *
+  * Behaves exactly like `caesar_encrypt`, except that it transforms exactly `len` bytes of
+  * `plain_text` instead of stopping at the first null character, and it does not write a
+  * terminating null character to `cipher_text`. Null bytes in the input are out of range
+  * and are copied through unchanged.
+  *
+  * \param len The number of bytes to transform.
+  *
+  * \pre `plain_text` and `cipher_text` must each point to at least `len` bytes, and must either
+  *       be identical or not overlap; see `cipher_update`.
+  * \pre The remaining preconditions of `caesar_encrypt` apply.
+  */
+void caesar_encrypt_n(char range_low, char range_high, int key, const char * plain_text,
+                      char * cipher_text, size_t len);
+
 /** Decrypt a given ciphertext using the Caesar cipher, using a specified key, where the
   * characters to decrypt fall within a given range (and all other characters are copied
   * over unchanged).
@@ -70,6 +88,22 @@ void caesar_encrypt(char range_low, char range_high, int key, const char * plain
   */
 void caesar_decrypt(char range_low, char range_high, int key, const char * cipher_text, char * plain_text);
 
+/** Length-explicit form of `caesar_decrypt`.
+  *
+  * Behaves exactly like `caesar_decrypt`, except that it transforms exactly `len` bytes of
+  * `cipher_text` instead of stopping at the first null character, and it does not write a
+  * terminating null character to `plain_text`. Null bytes in the input are out of range
+  * and are copied through unchanged.
+  *
+  * \param len The number of bytes to transform.
+  *
+  * \pre `cipher_text` and `plain_text` must each point to at least `len` bytes, and must either
+  *       be identical or not overlap; see `cipher_update`.
+  * \pre The remaining preconditions of `caesar_decrypt` apply.
+  */
+void caesar_decrypt_n(char range_low, char range_high, int key, const char * cipher_text,
+                      char * plain_text, size_t len);
+
 /** Encrypt a given plaintext using the Vigenere cipher, using a specified key, where the
   * characters to encrypt fall within a given range (and all other characters are copied
   * over unchanged).
@@ -104,6 +138,22 @@ void vigenere_encrypt(char range_low, char range_high, const char *key,
                       const char *plain_text, char *cipher_text
 );
 
+/** Length-explicit form of `vigenere_encrypt`.
+  *
+  * Behaves exactly like `vigenere_encrypt`, except that it transforms exactly `len` bytes of
+  * `plain_text` instead of stopping at the first null character, and it does not write a
+  * terminating null character to `cipher_text`. Null bytes in the input are out of range
+  * and are copied through unchanged.
+  *
+  * \param len The number of bytes to transform.
+  *
+  * \pre `plain_text` and `cipher_text` must each point to at least `len` bytes, and must either
+  *       be identical or not overlap; see `cipher_update`.
+  * \pre The remaining preconditions of `vigenere_encrypt` apply.
+  */
+void vigenere_encrypt_n(char range_low, char range_high, const char * key,
+                        const char * plain_text, char * cipher_text, size_t len);
+
 /** Decrypt a given ciphertext using the Vigenere cipher, using a specified key, where the
   * characters to decrypt fall within a given range (and all other characters are copied
   * over unchanged).
@@ -127,9 +177,199 @@ void vigenere_encrypt(char range_low, char range_high, const char *key,
   */
 void vigenere_decrypt(char range_low, char range_high, const char * key, const char * cipher_text, char * plain_text);
 
-/** TODO
- */
-int cli(int argc, char ** argv);
+/** Length-explicit form of `vigenere_decrypt`.
+  *
+  * Behaves exactly like `vigenere_decrypt`, except that it transforms exactly `len` bytes of
+  * `cipher_text` instead of stopping at the first null character, and it does not write a
+  * terminating null character to `plain_text`. Null bytes in the input are out of range
+  * and are copied through unchanged.
+  *
+  * \param len The number of bytes to transform.
+  *
+  * \pre `cipher_text` and `plain_text` must each point to at least `len` bytes, and must either
+  *       be identical or not overlap; see `cipher_update`.
+  * \pre The remaining preconditions of `vigenere_decrypt` apply.
+  */
+void vigenere_decrypt_n(char range_low, char range_high, const char * key,
+                        const char * cipher_text, char * plain_text, size_t len);
+
+/** A precomputed Caesar transform: the output byte for every possible input byte.
+  *
+  * Building the table costs one pass over the range; applying it costs a single lookup
+  * per byte, with no range comparisons or modular arithmetic. A table is worth building
+  * whenever the same (range, key) pair is applied to more than one buffer.
+  *
+  * ## Example usage
+  *
+  * ```c
+  *   caesar_table table;
+  *   caesar_table_init(&table, 'A', 'Z', 3);
+  *   for (size_t i = 0; i < message_count; i++) {
+  *       caesar_table_apply(&table, messages[i], messages[i], lengths[i]);
+  *   }
+  * ```
+  */
+typedef struct {
+  unsigned char map[256];
+} caesar_table;
+
+/** Build a table that encrypts characters between `range_low` and `range_high` with the
+  * Caesar cipher using `key`, and leaves every other byte unchanged. Use a negative key
+  * to build a decryption table.
+  *
+  * \pre `range_high` must be strictly greater than `range_low`.
+  */
+void caesar_table_init(caesar_table * table, char range_low, char range_high, int key);
+
+/** Add a second range to an existing table, shifting characters between `range_low` and
+  * `range_high` by `key` positions within that range. This lets one table handle, for
+  * instance, upper and lower case letters at once.
+  *
+  * \pre `range_high` must be strictly greater than `range_low`.
+  * \pre The new range must not overlap any range already added to `table`.
+  */
+void caesar_table_add_range(caesar_table * table, char range_low, char range_high, int key);
+
+/** Transform `len` bytes of `input` through `table` into `output`. `input` and `output`
+  * may be the same buffer. No terminating null character is written.
+  */
+void caesar_table_apply(const caesar_table * table, const char * input, char * output, size_t len);
+
+/** State for encrypting or decrypting a message in arbitrarily sized chunks.
+  *
+  * A `cipher_ctx` holds everything the Caesar and Vigenere ciphers need to carry from
+  * one chunk to the next: the character range, the per-position key shifts, and the
+  * running key index (the number of in-range characters seen so far). Feeding a message
+  * through `cipher_update` in any number of pieces produces exactly the same output as
+  * a single call to the corresponding one-shot function.
+  *
+  * A Caesar context is simply a Vigenere context whose key has a single position.
+  *
+  * ## Example usage
+  *
+  * ```c
+  *   cipher_ctx ctx;
+  *   char buf[65536];
+  *   size_t n;
+  *   if (vigenere_encrypt_init(&ctx, 'A', 'Z', "KEY") != 0) abort();
+  *   while ((n = fread(buf, 1, sizeof(buf), in)) > 0) {
+  *       cipher_update(&ctx, buf, buf, n);
+  *       fwrite(buf, 1, n, out);
+  *   }
+  *   cipher_final(&ctx);
+  * ```
+  *
+  * The fields are private to crypto.c; callers should treat the struct as opaque.
+  */
+typedef struct {
+  char range_low;
+  char range_high;
+  int range_size;
+  unsigned char * shifts;   // forward shift for each key position, already negated for
+                            // decryption, repeated to cover one period plus a kernel block
+  size_t key_len;
+  size_t period;            // multiple of key_len used to index shifts without a division
+  size_t key_index;
+} cipher_ctx;
+
+/** Initialise `ctx` for Caesar encryption with the given range and key.
+  *
+  * \return 0 on success, or -1 if memory for the context could not be allocated.
+  *
+  * \pre `range_high` must be strictly greater than `range_low`.
+  */
+int caesar_encrypt_init(cipher_ctx * ctx, char range_low, char range_high, int key);
+
+/** Initialise `ctx` for Caesar decryption with the given range and key.
+  *
+  * \return 0 on success, or -1 if memory for the context could not be allocated.
+  *
+  * \pre `range_high` must be strictly greater than `range_low`.
+  */
+int caesar_decrypt_init(cipher_ctx * ctx, char range_low, char range_high, int key);
+
+/** Initialise `ctx` for Vigenere encryption with the given range and key. The key is
+  * copied, so the caller's string need not outlive the context.
+  *
+  * \return 0 on success, or -1 if memory for the context could not be allocated.
+  *
+  * \pre `range_high` must be strictly greater than `range_low`.
+  * \pre `key` must not be an empty string.
+  */
+int vigenere_encrypt_init(cipher_ctx * ctx, char range_low, char range_high, const char * key);
+
+/** Initialise `ctx` for Vigenere decryption with the given range and key. The key is
+  * copied, so the caller's string need not outlive the context.
+  *
+  * \return 0 on success, or -1 if memory for the context could not be allocated.
+  *
+  * \pre `range_high` must be strictly greater than `range_low`.
+  * \pre `key` must not be an empty string.
+  */
+int vigenere_decrypt_init(cipher_ctx * ctx, char range_low, char range_high, const char * key);
+
+/** Transform the next `len` bytes of a message, continuing from wherever the previous
+  * call on `ctx` left off.
+  *
+  * `input` is not treated as a C string: embedded null bytes are copied through like any
+  * other out-of-range character, and no terminator is written to `output`.
+  *
+  * Each output byte depends only on the input byte at the same position and on how many
+  * in-range bytes came before it, so `input` and `output` may be the same buffer: passing
+  * one pointer for both transforms the buffer in place in a single pass. Partially
+  * overlapping buffers are not supported. The same holds for the `*_n` functions and
+  * `cipher_update_parallel`.
+  *
+  * \pre `ctx` must have been initialised by one of the `*_init` functions.
+  * \pre `input` and `output` must each point to at least `len` bytes.
+  */
+void cipher_update(cipher_ctx * ctx, const char * input, char * output, size_t len);
+
+/** Transform the next `len` bytes of a message like `cipher_update`, splitting the work
+  * across up to `threads` threads (the calling thread included).
+  *
+  * For Vigenere, the key index at the start of each chunk depends on how many in-range
+  * characters come before it, so the buffer is processed in two parallel passes: one
+  * that counts in-range characters per chunk, and one that transforms each chunk from
+  * the key index given by the running total of those counts. The output, and the state
+  * left in `ctx`, are identical to a single `cipher_update` call. Small buffers, or
+  * `threads` <= 1, are simply handed to `cipher_update`.
+  *
+  * \pre `ctx` must have been initialised by one of the `*_init` functions.
+  * \pre `input` and `output` must each point to at least `len` bytes, and must either
+  *       be identical or not overlap.
+  */
+void cipher_update_parallel(cipher_ctx * ctx, const char * input, char * output, size_t len,
+                            int threads);
+
+/** Rewind `ctx` to the start of a new message, keeping its range and key. This lets one
+  * prepared context be reused for any number of independent messages.
+  *
+  * \pre `ctx` must have been initialised by one of the `*_init` functions.
+  */
+void cipher_reset(cipher_ctx * ctx);
+
+/** Release the resources held by `ctx` and wipe its key material. The context must be
+  * initialised again before it is reused.
+  */
+void cipher_final(cipher_ctx * ctx);
+
+/** Select the implementation used for the Caesar and Vigenere ciphers.
+  *
+  * At startup the library picks the fastest kernel the CPU supports ("avx2", then
+  * "ssse3", then "sse2", then the portable "scalar" loops). The kernel is used by both
+  * the Caesar and the Vigenere functions; "sse2" has no byte shuffle, so it runs
+  * Vigenere with the scalar loop. Setting the `CRYPTO_KERNEL` environment
+  * variable to one of these names overrides that choice, as does calling this function.
+  * Every kernel produces identical output; the scalar one is the reference.
+  *
+  * \return 0 on success, or -1 if `name` is unknown or not supported by this CPU (in
+  *         which case the current kernel is kept).
+  */
+int crypto_set_kernel(const char * name);
+
+/** Return the name of the kernel currently in use. */
+const char * crypto_kernel_name(void);
 
 
 #endif
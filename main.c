@@ -7,6 +7,7 @@
 #include <limits.h>
 
 #include "crypto.h"
+#include "cli.h"
 
 int main(int argc, char **argv) {
     // Pass command-line arguments to the 'cli' function
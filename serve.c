@@ -0,0 +1,471 @@
+/**
+ * @file serve.c
+ * @brief Local encryption daemon for the cipher command-line interface.
+ *
+ * This file contains a server that listens on a Unix domain socket and answers
+ * framed encryption and decryption requests from any number of local clients,
+ * so that callers pay neither process start-up nor key preparation per message.
+ *
+ * ## Protocol
+ *
+ * Every frame, in either direction, is a 4-byte big-endian payload length followed
+ * by the payload. A request payload is a header line "<operation> <key>\n" (the same
+ * operations and keys as the command line) followed by the message bytes, which may
+ * contain any byte values. A response payload is one status byte, 0 for success or
+ * 1 for failure, followed by the transformed message or an error message. Clients
+ * may pipeline: responses on a connection come back in request order.
+ *
+ * @author
+ * Oliver Dean 21307131
+ *
+ * @bug No known bugs.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include "crypto.h"
+#include "cli.h"
+
+/** Largest request payload accepted; a client sending more is disconnected. */
+#define SERVE_MAX_FRAME (64 * 1024 * 1024)
+
+/** A connection stops being read while this much response data is waiting to be sent. */
+#define SERVE_OUT_HIGH_WATER (4 * 1024 * 1024)
+
+/** Bytes requested from the socket per read call. */
+#define SERVE_READ_SIZE (64 * 1024)
+
+/** Distinct keys each worker keeps prepared. */
+#define SERVE_CACHE_CAPACITY 1024
+
+/** Events handled per epoll_wait call. */
+#define SERVE_MAX_EVENTS 64
+
+/** Set by the signal handler to ask the workers to exit. */
+static volatile sig_atomic_t serve_stopping = 0;
+
+/**
+ * @brief A growable byte buffer with a consumed prefix.
+ */
+typedef struct {
+    char *data;
+    size_t start;       // bytes before this have been consumed
+    size_t len;         // bytes before this are valid
+    size_t cap;
+} serve_buffer;
+
+/**
+ * @brief The state of one client connection.
+ */
+typedef struct {
+    int fd;
+    unsigned events;    // the epoll events currently registered
+    serve_buffer in;
+    serve_buffer out;
+} serve_conn;
+
+/**
+ * @brief The state of one worker thread.
+ */
+typedef struct {
+    int listen_fd;
+    int epoll_fd;
+    key_cache *cache;
+} serve_worker;
+
+/**
+ * @brief Makes room for at least `extra` more bytes at the end of a buffer.
+ *
+ * @param buffer The buffer.
+ * @param extra The number of bytes needed.
+ * @return 0 on success, -1 if memory could not be allocated.
+ *
+ * Consumed bytes are discarded first, so a buffer only grows when it must.
+ */
+static int buffer_reserve(serve_buffer *buffer, size_t extra) {
+    if (buffer->start > 0) {
+        memmove(buffer->data, buffer->data + buffer->start, buffer->len - buffer->start);
+        buffer->len -= buffer->start;
+        buffer->start = 0;
+    }
+    if (buffer->cap - buffer->len >= extra) {
+        return 0;
+    }
+    size_t cap = buffer->cap > 0 ? buffer->cap : SERVE_READ_SIZE;
+    while (cap - buffer->len < extra) {
+        cap *= 2;
+    }
+    char *data = realloc(buffer->data, cap);
+    if (data == NULL) {
+        return -1;
+    }
+    buffer->data = data;
+    buffer->cap = cap;
+    return 0;
+}
+
+/**
+ * @brief Appends one response frame to a connection's output buffer.
+ *
+ * @param conn The connection.
+ * @param status 0 for success, 1 for failure.
+ * @param body The response body.
+ * @param body_len The length of the body.
+ * @return 0 on success, -1 if memory could not be allocated.
+ */
+static int queue_response(serve_conn *conn, unsigned char status, const char *body, size_t body_len) {
+    size_t payload_len = body_len + 1;
+    if (buffer_reserve(&conn->out, 4 + payload_len) != 0) {
+        return -1;
+    }
+    unsigned char *p = (unsigned char *)conn->out.data + conn->out.len;
+    p[0] = (unsigned char)(payload_len >> 24);
+    p[1] = (unsigned char)(payload_len >> 16);
+    p[2] = (unsigned char)(payload_len >> 8);
+    p[3] = (unsigned char)payload_len;
+    p[4] = status;
+    memcpy(p + 5, body, body_len);
+    conn->out.len += 4 + payload_len;
+    return 0;
+}
+
+/**
+ * @brief Runs one request and queues its response.
+ *
+ * @param worker The worker, for its key cache.
+ * @param conn The connection to respond on.
+ * @param payload The request payload; the message part is transformed in place.
+ * @param len The payload length.
+ * @return 0 on success, -1 if the response could not be queued.
+ */
+static int handle_request(serve_worker *worker, serve_conn *conn, char *payload, size_t len) {
+    char *newline = memchr(payload, '\n', len);
+    char *space = newline != NULL ? memchr(payload, ' ', (size_t)(newline - payload)) : NULL;
+    if (space == NULL) {
+        static const char message[] = "Expected '<operation> <key>' header line.";
+        return queue_response(conn, 1, message, sizeof(message) - 1);
+    }
+    *space = '\0';
+    *newline = '\0';
+
+    const char *error = NULL;
+    cipher_ctx *ctx = key_cache_get(worker->cache, payload, space + 1, &error);
+    if (ctx == NULL) {
+        return queue_response(conn, 1, error, strlen(error));
+    }
+    char *message = newline + 1;
+    size_t message_len = len - (size_t)(message - payload);
+    cipher_update(ctx, message, message, message_len);
+    return queue_response(conn, 0, message, message_len);
+}
+
+/**
+ * @brief Runs every complete request frame in a connection's input buffer.
+ *
+ * @param worker The worker.
+ * @param conn The connection.
+ * @return 0 on success, -1 if the client sent an oversized frame or memory ran out.
+ */
+static int handle_frames(serve_worker *worker, serve_conn *conn) {
+    serve_buffer *in = &conn->in;
+    while (in->len - in->start >= 4 && conn->out.len - conn->out.start < SERVE_OUT_HIGH_WATER) {
+        const unsigned char *p = (const unsigned char *)in->data + in->start;
+        size_t frame_len = (size_t)p[0] << 24 | (size_t)p[1] << 16 | (size_t)p[2] << 8 | p[3];
+        if (frame_len > SERVE_MAX_FRAME) {
+            return -1;
+        }
+        if (in->len - in->start - 4 < frame_len) {
+            break;
+        }
+        if (handle_request(worker, conn, in->data + in->start + 4, frame_len) != 0) {
+            return -1;
+        }
+        in->start += 4 + frame_len;
+    }
+    return 0;
+}
+
+/**
+ * @brief Sends as much queued output as the socket will take.
+ *
+ * @param conn The connection.
+ * @return 0 on success (including a full socket buffer), -1 if the connection failed.
+ */
+static int flush_output(serve_conn *conn) {
+    serve_buffer *out = &conn->out;
+    while (out->start < out->len) {
+        ssize_t n = send(conn->fd, out->data + out->start, out->len - out->start, MSG_NOSIGNAL);
+        if (n < 0) {
+            return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -1;
+        }
+        out->start += (size_t)n;
+    }
+    out->start = out->len = 0;
+    return 0;
+}
+
+/**
+ * @brief Closes a connection and frees its buffers.
+ *
+ * @param worker The worker that owns the connection.
+ * @param conn The connection.
+ */
+static void close_conn(serve_worker *worker, serve_conn *conn) {
+    epoll_ctl(worker->epoll_fd, EPOLL_CTL_DEL, conn->fd, NULL);
+    close(conn->fd);
+    free(conn->in.data);
+    free(conn->out.data);
+    free(conn);
+}
+
+/**
+ * @brief Registers the events a connection is currently interested in.
+ *
+ * @param worker The worker that owns the connection.
+ * @param conn The connection.
+ * @return 0 on success, -1 on failure.
+ *
+ * A connection is read only while its pending output is below SERVE_OUT_HIGH_WATER, so
+ * a client that pipelines requests without reading responses cannot grow the server's
+ * memory without bound; it is watched for writability whenever output is pending.
+ */
+static int update_events(serve_worker *worker, serve_conn *conn) {
+    size_t pending = conn->out.len - conn->out.start;
+    unsigned events = (pending < SERVE_OUT_HIGH_WATER ? EPOLLIN : 0) | (pending > 0 ? EPOLLOUT : 0);
+    if (events == conn->events) {
+        return 0;
+    }
+    struct epoll_event event = { .events = events, .data.ptr = conn };
+    conn->events = events;
+    return epoll_ctl(worker->epoll_fd, EPOLL_CTL_MOD, conn->fd, &event);
+}
+
+/**
+ * @brief Accepts every pending connection on the listening socket.
+ *
+ * @param worker The worker that will own the new connections.
+ */
+static void accept_conns(serve_worker *worker) {
+    for (;;) {
+        int fd = accept(worker->listen_fd, NULL, NULL);
+        if (fd < 0) {
+            return;     // EAGAIN: another worker took it, or none are left
+        }
+        serve_conn *conn = calloc(1, sizeof(*conn));
+        struct epoll_event event = { .events = EPOLLIN, .data.ptr = conn };
+        if (conn == NULL || fcntl(fd, F_SETFL, O_NONBLOCK) != 0
+                || epoll_ctl(worker->epoll_fd, EPOLL_CTL_ADD, fd, &event) != 0) {
+            free(conn);
+            close(fd);
+            continue;
+        }
+        conn->fd = fd;
+        conn->events = EPOLLIN;
+    }
+}
+
+/**
+ * @brief Handles readiness events on one connection.
+ *
+ * @param worker The worker that owns the connection.
+ * @param conn The connection.
+ * @param events The epoll events reported.
+ */
+static void service_conn(serve_worker *worker, serve_conn *conn, unsigned events) {
+    int ok = 1;
+    if (events & EPOLLIN) {
+        if (buffer_reserve(&conn->in, SERVE_READ_SIZE) != 0) {
+            ok = 0;
+        } else {
+            ssize_t n = recv(conn->fd, conn->in.data + conn->in.len, conn->in.cap - conn->in.len, 0);
+            if (n > 0) {
+                conn->in.len += (size_t)n;
+            } else if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+                ok = 0;
+            }
+        }
+    } else if (events & (EPOLLERR | EPOLLHUP)) {
+        ok = 0;
+    }
+
+    // Output may have been throttled at the high-water mark, so frames already buffered
+    // are retried after every flush, not only after new input arrives.
+    if (ok && (handle_frames(worker, conn) != 0 || flush_output(conn) != 0
+               || handle_frames(worker, conn) != 0 || update_events(worker, conn) != 0)) {
+        ok = 0;
+    }
+    if (!ok) {
+        close_conn(worker, conn);
+    }
+}
+
+/**
+ * @brief Event loop of one worker thread.
+ *
+ * @param arg The serve_worker.
+ * @return NULL.
+ *
+ * Every worker has its own epoll instance and key cache, and shares only the listening
+ * socket (registered with EPOLLEXCLUSIVE so a new connection wakes a single worker).
+ * A connection is handled entirely by the worker that accepted it, so no locks are
+ * needed. The loop wakes periodically to check for a shutdown request.
+ */
+static void *serve_worker_main(void *arg) {
+    serve_worker *worker = arg;
+    struct epoll_event events[SERVE_MAX_EVENTS];
+    while (!serve_stopping) {
+        int n = epoll_wait(worker->epoll_fd, events, SERVE_MAX_EVENTS, 500);
+        for (int i = 0; i < n; i++) {
+            if (events[i].data.ptr == NULL) {
+                accept_conns(worker);
+            } else {
+                service_conn(worker, events[i].data.ptr, events[i].events);
+            }
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Signal handler that asks the server to stop.
+ *
+ * @param signum The signal number (unused).
+ */
+static void serve_stop(int signum) {
+    (void)signum;
+    serve_stopping = 1;
+}
+
+/**
+ * @brief Creates the listening socket.
+ *
+ * @param socket_path The path to bind.
+ * @return The socket, or -1 on failure (with a message on standard error).
+ *
+ * A socket already at the path is probed with connect(). It is removed only when the
+ * connection is refused, as for a stale socket left by an earlier run; if another
+ * server accepts the connection, or the probe fails for any other reason, the server
+ * refuses to start. Any other kind of file is left alone and the bind fails. The socket is created with mode 0600 so only the
+ * owner can connect.
+ */
+static int open_listener(const char *socket_path) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(socket_path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "Socket path is too long.\n");
+        return -1;
+    }
+    strcpy(addr.sun_path, socket_path);
+
+    struct stat st;
+    if (lstat(socket_path, &st) == 0 && S_ISSOCK(st.st_mode)) {
+        int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (probe < 0) {
+            perror("Failed to create socket");
+            return -1;
+        }
+        int connected = connect(probe, (struct sockaddr *)&addr, sizeof(addr));
+        int probe_error = errno;
+        close(probe);
+        if (connected == 0) {
+            fprintf(stderr, "Another server is already listening on %s.\n", socket_path);
+            return -1;
+        }
+        if (probe_error != ECONNREFUSED) {
+            errno = probe_error;
+            perror("Failed to check the existing socket");
+            return -1;
+        }
+        unlink(socket_path);
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        perror("Failed to create socket");
+        return -1;
+    }
+    mode_t old_mask = umask(077);
+    int rc = bind(fd, (struct sockaddr *)&addr, sizeof(addr));
+    umask(old_mask);
+    if (rc != 0 || listen(fd, SOMAXCONN) != 0 || fcntl(fd, F_SETFL, O_NONBLOCK) != 0) {
+        perror("Failed to listen on socket");
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * @brief Runs the encryption daemon until it receives SIGINT or SIGTERM.
+ *
+ * @param socket_path The Unix domain socket path to listen on.
+ * @param threads The number of worker threads.
+ * @return 0 after a clean shutdown, 1 if the server could not start.
+ */
+int run_server(const char *socket_path, int threads) {
+    assert(socket_path != NULL && threads > 0);
+    int listen_fd = open_listener(socket_path);
+    if (listen_fd < 0) {
+        return 1;
+    }
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = serve_stop;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    serve_worker *workers = calloc((size_t)threads, sizeof(*workers));
+    pthread_t *ids = calloc((size_t)threads, sizeof(*ids));
+    int started = 0;
+    int status = 0;
+    if (workers == NULL || ids == NULL) {
+        fprintf(stderr, "Memory allocation failed.\n");
+        status = 1;
+    }
+    for (int t = 0; status == 0 && t < threads; t++) {
+        serve_worker *worker = &workers[t];
+        struct epoll_event event = { .events = EPOLLIN | EPOLLEXCLUSIVE, .data.ptr = NULL };
+        worker->listen_fd = listen_fd;
+        worker->epoll_fd = epoll_create1(0);
+        worker->cache = key_cache_new(SERVE_CACHE_CAPACITY);
+        if (worker->epoll_fd < 0 || worker->cache == NULL
+                || epoll_ctl(worker->epoll_fd, EPOLL_CTL_ADD, listen_fd, &event) != 0
+                || pthread_create(&ids[t], NULL, serve_worker_main, worker) != 0) {
+            fprintf(stderr, "Failed to start worker %d.\n", t);
+            if (worker->epoll_fd >= 0) close(worker->epoll_fd);
+            key_cache_free(worker->cache);
+            status = 1;
+            serve_stopping = 1;
+            break;
+        }
+        started++;
+    }
+
+    for (int t = 0; t < started; t++) {
+        pthread_join(ids[t], NULL);
+        close(workers[t].epoll_fd);
+        key_cache_free(workers[t].cache);
+    }
+    // Connections still open at shutdown are reclaimed by process exit.
+    free(workers);
+    free(ids);
+    close(listen_fd);
+    unlink(socket_path);
+    return status;
+}
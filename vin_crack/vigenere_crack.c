@@ -3,13 +3,51 @@
 #include <string.h>
 #include <ctype.h>
 #include <math.h>
+#include <errno.h>
 #include <stdbool.h>
+#include <time.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "vigenere_crack.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <emmintrin.h>
+#endif
 
-#define MAX_KEY_LENGTH 10
-#define ALPHABET_SIZE 26
 #define MIN_KEY_LENGTH 1
 #define GOOD_ENOUGH_THRESHOLD 100
 
+/** A parallel brute-force task fixes all but this many trailing key letters, so it scores up to 26^3 keys. */
+#define TASK_SUFFIX_LETTERS 3
+
+/** Upper bound on the number of threads in a parallel brute-force search. */
+#define BRUTE_FORCE_MAX_THREADS 256
+
+/** Relative slack before a prefix's chi-square lower bound counts as beaten; covers rounding. */
+#define PRUNE_TOLERANCE 1e-9
+
+/** A mean index of coincidence at least this high means each column looks like English (English is about 0.066, random letters 0.038). */
+#define ENGLISH_IOC_THRESHOLD 0.058
+
+/** Otherwise a key length is accepted when its mean index of coincidence is at least this fraction of the best. */
+#define PERIOD_IOC_TOLERANCE 0.9
+
+/** Most letter pairs compared at each shift when scoring key lengths. */
+#define AUTOCORRELATION_SAMPLE ((size_t)1 << 16)
+
+/** Shifts counted beyond the longest key length considered, so short key lengths are scored from many multiples. */
+#define AUTOCORRELATION_SHIFTS ((size_t)4096)
+
+/** Fewest letter pairs a shift needs before its coincidence rate is used. */
+#define PERIOD_MIN_PAIRS 32
+
+/** Standard errors subtracted from a key length's coincidence rate to rank it. */
+#define PERIOD_RANK_Z 2.0
+
+/** Words of decrypted text shown for each key of a --top ranking. */
+#define RANKED_PREVIEW_WORDS 10
+
 double english_frequencies[ALPHABET_SIZE] = {
     8.167, 1.492, 2.782, 4.253, 12.702, 2.228, 2.015, 6.094,
     6.966, 0.153, 0.772, 4.025, 2.406, 6.749, 7.507, 1.929,
@@ -52,15 +90,16 @@ int strcasecmp_custom(const char *s1, const char *s2) {
 }
 
 /**
- * @brief Decrypts a given ciphertext using the Vigenere cipher with a specified key.
+ * @brief Decrypts the first characters of a ciphertext with the Vigenere cipher.
  *
  * @param key Pointer to the null-terminated string containing the encryption key.
- * @param cipher_text Pointer to the null-terminated string containing the ciphertext to be decrypted.
- * @param plain_text Pointer to the buffer where the decrypted text will be stored.
+ * @param cipher_text Pointer to the ciphertext, at least text_len characters long.
+ * @param text_len The number of characters to decrypt.
+ * @param plain_text Pointer to a buffer of at least text_len + 1 bytes, which receives them null-terminated.
  */
-void vigenere_decrypt(const char *key, const char *cipher_text, char *plain_text) {
+static void decrypt_prefix(const char *key, const char *cipher_text, size_t text_len, char *plain_text) {
     size_t key_len = strlen(key);
-    for (size_t i = 0, j = 0; i < strlen(cipher_text); i++) {
+    for (size_t i = 0, j = 0; i < text_len; i++) {
         if (isalpha(cipher_text[i])) {
             char offset = isupper(cipher_text[i]) ? 'A' : 'a';
             char key_offset = isupper(key[j % key_len]) ? 'A' : 'a';
@@ -70,7 +109,41 @@ void vigenere_decrypt(const char *key, const char *cipher_text, char *plain_text
             plain_text[i] = cipher_text[i];
         }
     }
-    plain_text[strlen(cipher_text)] = '\0';
+    plain_text[text_len] = '\0';
+}
+
+/**
+ * @brief Decrypts a given ciphertext using the Vigenere cipher with a specified key.
+ *
+ * @param key Pointer to the null-terminated string containing the encryption key.
+ * @param cipher_text Pointer to the null-terminated string containing the ciphertext to be decrypted.
+ * @param plain_text Pointer to the buffer where the decrypted text will be stored.
+ */
+void vigenere_crack_decrypt(const char *key, const char *cipher_text, char *plain_text) {
+    decrypt_prefix(key, cipher_text, strlen(cipher_text), plain_text);
+}
+
+/**
+ * @brief Calculates the chi-square statistic of a letter histogram against English letter frequencies.
+ *
+ * @param counts The number of times each letter occurs, A first.
+ * @return The chi-square statistic.
+ */
+double chi_square_of_counts(const size_t counts[ALPHABET_SIZE]) {
+    size_t total_chars = 0;
+    for (int i = 0; i < ALPHABET_SIZE; i++) {
+        total_chars += counts[i];
+    }
+
+    double chi_square = 0.0;
+    for (int i = 0; i < ALPHABET_SIZE; i++) {
+        double expected = english_frequencies[i] * total_chars / 100;
+        double difference = counts[i] - expected;
+        if (expected > 0) {
+            chi_square += difference * difference / expected;
+        }
+    }
+    return chi_square;
 }
 
 /**
@@ -80,44 +153,257 @@ void vigenere_decrypt(const char *key, const char *cipher_text, char *plain_text
  * @return The chi-square statistic.
  */
 double calculate_chi_square(const char *text) {
-    static struct {
-        char *text;
-        double chi_square;
-    } cache[10000] = {{NULL, 0.0}};
-    static int cache_size = 0;
-
-    for (int i = 0; i < cache_size; ++i) {
-        if (strcmp(cache[i].text, text) == 0) {
-            return cache[i].chi_square;
+    size_t counts[ALPHABET_SIZE] = {0};
+    for (const char *p = text; *p; p++) {
+        if (isalpha((unsigned char)*p)) {
+            counts[tolower((unsigned char)*p) - 'a']++;
         }
     }
+    return chi_square_of_counts(counts);
+}
 
-    int counts[ALPHABET_SIZE] = {0};
-    int total_chars = 0;
+/**
+ * @brief Builds a ciphertext letter histogram for every column of every key length.
+ *
+ * @param cipher_text Pointer to the null-terminated ciphertext.
+ * @param counts Receives counts[length][column][letter] for key lengths 1 to MAX_KEY_LENGTH.
+ * @return The number of letters in the ciphertext.
+ *
+ * Only letters advance the key, so a letter's column is its index among the letters
+ * modulo the key length. The text is read once for all key lengths.
+ */
+static size_t count_key_columns(const char *cipher_text, size_t counts[MAX_KEY_LENGTH + 1][MAX_KEY_LENGTH][ALPHABET_SIZE]) {
+    memset(counts, 0, sizeof(size_t) * (MAX_KEY_LENGTH + 1) * MAX_KEY_LENGTH * ALPHABET_SIZE);
+    int columns[MAX_KEY_LENGTH + 1] = {0};
+    size_t letters = 0;
+    for (const char *p = cipher_text; *p; p++) {
+        if (!isalpha((unsigned char)*p)) {
+            continue;
+        }
+        letters++;
+        int letter = tolower((unsigned char)*p) - 'a';
+        for (int length = MIN_KEY_LENGTH; length <= MAX_KEY_LENGTH; length++) {
+            counts[length][columns[length]][letter]++;
+            if (++columns[length] == length) {
+                columns[length] = 0;
+            }
+        }
+    }
+    return letters;
+}
 
-    for (size_t i = 0; i < strlen(text); i++) {
-        if (isalpha(text[i])) {
-            counts[tolower(text[i]) - 'a']++;
-            total_chars++;
+/**
+ * @brief Calculates the chi-square statistic of all 26 keys that differ only in their last letter.
+ *
+ * @param partial The plaintext letter histogram of every column but the last.
+ * @param column The ciphertext letter histogram of the last column.
+ * @param total_letters The number of letters in the whole ciphertext.
+ * @param chi_squares Receives chi_squares[shift], the statistic with the last key letter 'A' + shift.
+ *
+ * The last letter only rotates the last column, so letter i of the plaintext occurs
+ * partial[i] + column[(i + shift) % 26] times. The variants are scored side by side, two
+ * per vector on x86, with each lane adding up the same terms in the same order as
+ * chi_square_of_counts, so the statistics are identical to scoring the keys one by one.
+ */
+static void chi_square_of_last_letters(const size_t partial[ALPHABET_SIZE], const size_t column[ALPHABET_SIZE],
+                                       size_t total_letters, double chi_squares[ALPHABET_SIZE]) {
+    double rotated[2 * ALPHABET_SIZE];
+    for (int i = 0; i < 2 * ALPHABET_SIZE; i++) {
+        rotated[i] = (double)column[i % ALPHABET_SIZE];
+    }
+    for (int shift = 0; shift < ALPHABET_SIZE; shift++) {
+        chi_squares[shift] = 0.0;
+    }
+    for (int i = 0; i < ALPHABET_SIZE; i++) {
+        double expected = english_frequencies[i] * total_letters / 100;
+        if (expected <= 0) {
+            continue;
+        }
+        double count = (double)partial[i];
+#if defined(__x86_64__) || defined(__i386__)
+        __m128d vector_count = _mm_set1_pd(count), vector_expected = _mm_set1_pd(expected);
+        for (int shift = 0; shift < ALPHABET_SIZE; shift += 2) {
+            __m128d difference = _mm_sub_pd(_mm_add_pd(vector_count, _mm_loadu_pd(&rotated[i + shift])), vector_expected);
+            __m128d term = _mm_div_pd(_mm_mul_pd(difference, difference), vector_expected);
+            _mm_storeu_pd(&chi_squares[shift], _mm_add_pd(_mm_loadu_pd(&chi_squares[shift]), term));
+        }
+#else
+        for (int shift = 0; shift < ALPHABET_SIZE; shift++) {
+            double difference = count + rotated[i + shift] - expected;
+            chi_squares[shift] += difference * difference / expected;
         }
+#endif
     }
+}
 
-    double chi_square = 0.0;
+/**
+ * @brief Bounds the chi-square statistic of every key that starts with a given prefix.
+ *
+ * @param counts The plaintext letter histogram of the columns the prefix decrypts.
+ * @param total_letters The number of letters in the whole ciphertext.
+ * @return A lower bound on the chi-square statistic of the whole plaintext.
+ *
+ * Whatever the remaining key letters are, the remaining columns only add letters, so each
+ * letter ends with at least its count so far. The bound is the least chi-square over all
+ * real-valued ways of adding the remaining letters: they fill the letters furthest below
+ * their expected count up to a common fraction t of it, and the rest keep their counts.
+ */
+static double chi_square_lower_bound(const size_t counts[ALPHABET_SIZE], size_t total_letters) {
+    double expected[ALPHABET_SIZE];
+    int order[ALPHABET_SIZE];
+    size_t remaining = total_letters;
     for (int i = 0; i < ALPHABET_SIZE; i++) {
-        double expected = english_frequencies[i] * total_chars / 100;
-        double observed = counts[i];
-        if (expected > 0) {
-            chi_square += pow(observed - expected, 2) / expected;
+        expected[i] = english_frequencies[i] * total_letters / 100;
+        remaining -= counts[i];
+        // Insertion sort by counts[i] / expected[i], the fraction of its expected count filled.
+        int j = i;
+        for (; j > 0 && counts[order[j - 1]] * expected[i] > counts[i] * expected[order[j - 1]]; j--) {
+            order[j] = order[j - 1];
         }
+        order[j] = i;
+    }
+    if (total_letters == 0) {
+        return 0.0;
     }
 
-    if (cache_size < 1000) {
-        cache[cache_size].text = strdup_custom(text);
-        cache[cache_size].chi_square = chi_square;
-        cache_size++;
+    // Raise the k least-filled letters to t times their expected count, for the k that fits.
+    double filled = (double)remaining, filled_expected = 0.0, t = 0.0;
+    int k = 0;
+    while (k < ALPHABET_SIZE) {
+        filled += counts[order[k]];
+        filled_expected += expected[order[k]];
+        k++;
+        t = filled / filled_expected;
+        if (k == ALPHABET_SIZE || t <= counts[order[k]] / expected[order[k]]) {
+            break;
+        }
     }
 
-    return chi_square;
+    double bound = (t - 1) * (t - 1) * filled_expected;
+    for (int j = k; j < ALPHABET_SIZE; j++) {
+        double difference = counts[order[j]] - expected[order[j]];
+        bound += difference * difference / expected[order[j]];
+    }
+    return bound;
+}
+
+/**
+ * @brief Decides whether a key prefix's subtree must still be searched.
+ *
+ * @param bound The chi_square_lower_bound of the prefix.
+ * @param best_chi_square The best score found so far.
+ * @return true unless no key below the prefix can beat the best score or be good enough.
+ *
+ * A key scoring exactly the bound could tie the best, so only a strictly higher bound
+ * prunes, with PRUNE_TOLERANCE of slack for rounding in the bound.
+ */
+static bool prefix_can_win(double bound, double best_chi_square) {
+    double limit = best_chi_square > GOOD_ENOUGH_THRESHOLD ? best_chi_square : GOOD_ENOUGH_THRESHOLD;
+    return bound <= limit * (1 + PRUNE_TOLERANCE);
+}
+
+/**
+ * @brief Counts a pruned subtree's keys as searched, as far as the candidate budget allows.
+ *
+ * @param stats The search counters and budget.
+ * @param keys The number of keys in the subtree.
+ */
+static void skip_keys(vigenere_crack_stats *stats, size_t keys) {
+    if (stats->max_candidates != 0 && stats->max_candidates - stats->candidates < keys) {
+        stats->candidates = stats->max_candidates;
+        stats->budget_exhausted = true;
+    } else {
+        stats->candidates += keys;
+    }
+}
+
+/**
+ * @brief The best keys a search has scored so far, as a bounded max-heap of (key, score) pairs.
+ *
+ * keys[0] is the worst key kept, so a candidate is compared with it alone and the heap
+ * is only touched when the candidate gets in.
+ */
+typedef struct {
+    vigenere_key_score *keys;
+    int size;                           // the most keys kept
+    int count;
+} key_ranking;
+
+/**
+ * @brief Decides whether one ranked key is worse than another.
+ *
+ * @return true if a has the higher chi-square, or the same one and comes later in the search order.
+ */
+static bool key_score_worse(const vigenere_key_score *a, const vigenere_key_score *b) {
+    return a->chi_square > b->chi_square || (a->chi_square == b->chi_square && a->candidate > b->candidate);
+}
+
+/**
+ * @brief Returns the score a candidate must beat to enter a ranking: INFINITY until it is full.
+ */
+static double ranking_threshold(const key_ranking *ranking) {
+    return ranking->count < ranking->size ? INFINITY : ranking->keys[0].chi_square;
+}
+
+/**
+ * @brief Restores the heap order below a position whose key may be better than its children's.
+ *
+ * @param keys The heap.
+ * @param count The number of keys in the heap.
+ * @param position The position to sift down from.
+ */
+static void sift_down(vigenere_key_score *keys, int count, int position) {
+    for (;;) {
+        int worst = position;
+        for (int child = 2 * position + 1; child <= 2 * position + 2 && child < count; child++) {
+            if (key_score_worse(&keys[child], &keys[worst])) {
+                worst = child;
+            }
+        }
+        if (worst == position) {
+            return;
+        }
+        vigenere_key_score swap = keys[position];
+        keys[position] = keys[worst];
+        keys[worst] = swap;
+        position = worst;
+    }
+}
+
+/**
+ * @brief Adds a candidate to a ranking if it beats the worst key kept.
+ *
+ * @param ranking The ranking.
+ * @param key The candidate key.
+ * @param chi_square Its score.
+ * @param candidate Its number in the search order.
+ */
+static void ranking_add(key_ranking *ranking, const char *key, double chi_square, size_t candidate) {
+    vigenere_key_score entry = { .chi_square = chi_square, .candidate = candidate };
+    strcpy(entry.key, key);
+    if (ranking->count < ranking->size) {
+        int position = ranking->count++;
+        while (position > 0 && key_score_worse(&entry, &ranking->keys[(position - 1) / 2])) {
+            ranking->keys[position] = ranking->keys[(position - 1) / 2];
+            position = (position - 1) / 2;
+        }
+        ranking->keys[position] = entry;
+    } else if (key_score_worse(&ranking->keys[0], &entry)) {
+        ranking->keys[0] = entry;
+        sift_down(ranking->keys, ranking->count, 0);
+    }
+}
+
+/**
+ * @brief Sorts a ranking in place, best key first. It is no longer a heap afterwards.
+ */
+static void ranking_sort(key_ranking *ranking) {
+    for (int end = ranking->count - 1; end > 0; end--) {
+        vigenere_key_score worst = ranking->keys[0];
+        ranking->keys[0] = ranking->keys[end];
+        ranking->keys[end] = worst;
+        sift_down(ranking->keys, end, 0);
+    }
 }
 
 /**
@@ -126,57 +412,812 @@ double calculate_chi_square(const char *text) {
  * @param key Pointer to the buffer where the current key is being built.
  * @param position The current position in the key being generated.
  * @param max_length The maximum length of the keys to generate.
+ * @param columns The ciphertext letter histogram of each key column for this key length.
+ * @param plain_counts plain_counts[position] is the plaintext letter histogram of columns 0 to position - 1 under the key so far; the deeper rows are scratch space.
+ * @param total_letters The number of letters in the ciphertext, for pruning.
+ * @param ranking The best keys found so far.
+ * @param found_good_enough Pointer to the flag set when a key scores below GOOD_ENOUGH_THRESHOLD, which ends the search.
+ * @param stats Pointer to the search counters and candidate budget; budget_exhausted also ends the search.
+ *
+ * Decrypting a column with a key letter rotates its histogram, so each key letter adds
+ * its column's rotated histogram to the running plaintext histogram. The 26 keys that
+ * differ only in their last letter are scored together from that histogram, however long
+ * the ciphertext is. With
+ * stats->prune set, a prefix whose lower bound cannot win is not searched further; its
+ * keys still count as searched, so the result and the budget are those of the full search.
+ */
+void generate_keys(char *key, int position, int max_length, size_t columns[][ALPHABET_SIZE], size_t plain_counts[][ALPHABET_SIZE], size_t total_letters, key_ranking *ranking, bool *found_good_enough, vigenere_crack_stats *stats) {
+    if (*found_good_enough || stats->budget_exhausted) return;
+
+    if (position == max_length - 1) {
+        double chi_squares[ALPHABET_SIZE];
+        chi_square_of_last_letters(plain_counts[position], columns[position], total_letters, chi_squares);
+        key[max_length] = '\0';
+        for (int shift = 0; shift < ALPHABET_SIZE; shift++) {
+            if (stats->max_candidates != 0 && stats->candidates == stats->max_candidates) {
+                stats->budget_exhausted = true;
+                return;
+            }
+            stats->candidates++;
+            stats->scored++;
+            key[position] = (char)('A' + shift);
+
+            if (chi_squares[shift] < ranking_threshold(ranking)) {
+                ranking_add(ranking, key, chi_squares[shift], stats->candidates - 1);
+            }
+
+            if (chi_squares[shift] < GOOD_ENOUGH_THRESHOLD) {
+                *found_good_enough = true;
+                return;
+            }
+        }
+        return;
+    }
+
+    size_t subtree_keys = 1;
+    for (int i = position + 1; i < max_length; i++) {
+        subtree_keys *= ALPHABET_SIZE;
+    }
+    for (int shift = 0; shift < ALPHABET_SIZE; shift++) {
+        key[position] = (char)('A' + shift);
+        for (int i = 0; i < ALPHABET_SIZE; i++) {
+            plain_counts[position + 1][i] = plain_counts[position][i] + columns[position][(i + shift) % ALPHABET_SIZE];
+        }
+        if (stats->prune) {
+            stats->nodes_visited++;
+            if (!prefix_can_win(chi_square_lower_bound(plain_counts[position + 1], total_letters), ranking_threshold(ranking))) {
+                stats->nodes_pruned++;
+                skip_keys(stats, subtree_keys);
+                if (stats->budget_exhausted) return;
+                continue;
+            }
+        }
+        generate_keys(key, position + 1, max_length, columns, plain_counts, total_letters, ranking, found_good_enough, stats);
+        if (*found_good_enough || stats->budget_exhausted) return;
+    }
+}
+
+/**
+ * @brief Finds the best key for decrypting the ciphertext using brute force.
+ *
  * @param cipher_text Pointer to the null-terminated string containing the ciphertext to decrypt.
  * @param best_key Pointer to the buffer where the best key will be stored.
- * @param best_plain_text Pointer to the buffer where the decrypted text will be stored.
- * @param best_chi_square Pointer to the variable holding the best chi-square value found so far.
+ * @param best_plain_text Pointer to the buffer where the decrypted text will be stored, or NULL.
+ * @param stats Pointer to the candidate budget, search counters and ranking, or NULL for an unlimited search.
+ *
+ * The ciphertext is read once to build the column histograms and decrypted once with the
+ * best key; candidates are scored from the histograms alone, and ranked by their scores.
  */
-void generate_keys(char *key, int position, int max_length, const char *cipher_text, char *best_key, char *best_plain_text, double *best_chi_square, bool *found_good_enough) {
-    if (*found_good_enough) return;
+void find_best_key_brute_force(const char *cipher_text, char *best_key, char *best_plain_text, vigenere_crack_stats *stats) {
+    vigenere_crack_stats unlimited = {0};
+    if (stats == NULL) {
+        stats = &unlimited;
+    }
+    stats->candidates = 0;
+    stats->scored = 0;
+    stats->nodes_visited = 0;
+    stats->nodes_pruned = 0;
+    stats->budget_exhausted = false;
+
+    size_t counts[MAX_KEY_LENGTH + 1][MAX_KEY_LENGTH][ALPHABET_SIZE];
+    size_t plain_counts[MAX_KEY_LENGTH + 1][ALPHABET_SIZE] = {{0}};
+    size_t total_letters = count_key_columns(cipher_text, counts);
+
+    vigenere_key_score best;
+    key_ranking ranking = { stats->top != NULL ? stats->top : &best, stats->top != NULL ? stats->top_size : 1, 0 };
+    char key[MAX_KEY_LENGTH + 1] = {0};
+    bool found_good_enough = false;
+
+    for (int key_length = MIN_KEY_LENGTH; key_length <= MAX_KEY_LENGTH; key_length++) {
+        generate_keys(key, 0, key_length, counts[key_length], plain_counts, total_letters, &ranking, &found_good_enough, stats);
+        if (found_good_enough || stats->budget_exhausted) break;
+    }
+    ranking_sort(&ranking);
+    stats->top_count = ranking.count;
+    stats->best_chi_square = ranking.count > 0 ? ranking.keys[0].chi_square : INFINITY;
+    if (ranking.count > 0) {
+        strcpy(best_key, ranking.keys[0].key);
+        if (best_plain_text != NULL) {
+            vigenere_crack_decrypt(best_key, cipher_text, best_plain_text);
+        }
+    }
+}
 
-    if (position == max_length) {
-        key[position] = '\0';
-        char *plain_text = malloc(strlen(cipher_text) + 1);
-        vigenere_decrypt(key, cipher_text, plain_text);
-        double chi_square = calculate_chi_square(plain_text);
+/**
+ * @brief One key length's share of a parallel brute-force search.
+ *
+ * Candidates are numbered in the order the serial search visits them. The key space of
+ * the length is split into tasks that fix all but the last TASK_SUFFIX_LETTERS letters.
+ */
+typedef struct {
+    size_t (*columns)[ALPHABET_SIZE];   // the ciphertext column histograms for this key length
+    int key_length;
+    int prefix_length;                  // the letters fixed by a task
+    size_t subtree_sizes[MAX_KEY_LENGTH + 1]; // candidates below each key position: 26^(key_length - position)
+    size_t first_index;                 // the number of the first candidate of this length
+    size_t limit;                       // candidates from this number on are outside the budget
+    atomic_size_t *first_good;          // the number of the earliest good-enough candidate found, shared
+    _Atomic double *prune_threshold;    // the lowest ranking threshold of any worker, shared for pruning
+    bool prune;
+    size_t total_letters;
+} brute_force_pass;
+
+/**
+ * @brief A worker thread of a parallel brute-force search, and the tasks it still owns.
+ */
+typedef struct brute_force_worker {
+    brute_force_pass *pass;
+    struct brute_force_worker *workers; // every worker of the pass, for stealing
+    int worker_count;
+    pthread_mutex_t lock;               // guards next and end
+    size_t next, end;                   // the tasks not yet started: [next, end)
+    size_t plain_counts[MAX_KEY_LENGTH + 1][ALPHABET_SIZE];
+    char key[MAX_KEY_LENGTH + 1];
+    key_ranking ranking;                // the best candidates this worker has scored, over all passes
+    size_t good_index;                  // the earliest good-enough candidate this worker found, or SIZE_MAX
+    double good_chi_square;
+    char good_key[MAX_KEY_LENGTH + 1];
+    size_t scored, nodes_visited, nodes_pruned;
+} brute_force_worker;
+
+/**
+ * @brief Decides whether a parallel worker must search below a key prefix, and counts the check.
+ *
+ * @param worker The worker, whose plain_counts[length] holds the prefix's plaintext histogram.
+ * @param length The length of the prefix.
+ * @return true unless the prefix is pruned.
+ *
+ * Each worker's ranking holds only part of the keys, so its threshold is never below the
+ * serial search's, and the lowest of them is safe to prune with. The shared threshold
+ * can come from a key after the earliest good-enough one, which the serial search never
+ * reaches, so prefix_can_win also keeps every prefix that could hold a good-enough key.
+ * Pruned keys still advance the candidate numbers.
+ */
+static bool brute_force_prefix_can_win(brute_force_worker *worker, int length) {
+    brute_force_pass *pass = worker->pass;
+    worker->nodes_visited++;
+    double bound = chi_square_lower_bound(worker->plain_counts[length], pass->total_letters);
+    if (prefix_can_win(bound, atomic_load_explicit(pass->prune_threshold, memory_order_relaxed))) {
+        return true;
+    }
+    worker->nodes_pruned++;
+    return false;
+}
 
-        if (chi_square < *best_chi_square) {
-            *best_chi_square = chi_square;
-            strcpy(best_key, key);
-            strcpy(best_plain_text, plain_text);
+/**
+ * @brief Scores every key below a key position, in serial order.
+ *
+ * @param worker The worker, whose key and plain_counts hold the letters before position.
+ * @param position The key position to vary.
+ * @param index The number of the first candidate below this position.
+ * @return false if the task should stop: a good-enough key was found here or earlier in
+ *         the serial order, or the budget ran out.
+ */
+static bool search_key_suffix(brute_force_worker *worker, int position, size_t index) {
+    brute_force_pass *pass = worker->pass;
+    size_t subtree = pass->subtree_sizes[position + 1];
+    bool last = position + 1 == pass->key_length;
+    double chi_squares[ALPHABET_SIZE];
+    if (last) {
+        chi_square_of_last_letters(worker->plain_counts[position], pass->columns[position], pass->total_letters, chi_squares);
+    }
+    for (int shift = 0; shift < ALPHABET_SIZE; shift++, index += subtree) {
+        if (index >= pass->limit || index > atomic_load_explicit(pass->first_good, memory_order_relaxed)) {
+            return false;
+        }
+        worker->key[position] = (char)('A' + shift);
+        if (!last) {
+            for (int i = 0; i < ALPHABET_SIZE; i++) {
+                worker->plain_counts[position + 1][i] = worker->plain_counts[position][i] + pass->columns[position][(i + shift) % ALPHABET_SIZE];
+            }
+            if (pass->prune && !brute_force_prefix_can_win(worker, position + 1)) {
+                continue;
+            }
+            if (!search_key_suffix(worker, position + 1, index)) {
+                return false;
+            }
+            continue;
         }
 
+        double chi_square = chi_squares[shift];
+        worker->scored++;
+        if (chi_square <= ranking_threshold(&worker->ranking)) {
+            ranking_add(&worker->ranking, worker->key, chi_square, index);
+            double threshold = ranking_threshold(&worker->ranking);
+            double shared = atomic_load_explicit(pass->prune_threshold, memory_order_relaxed);
+            while (threshold < shared && !atomic_compare_exchange_weak(pass->prune_threshold, &shared, threshold)) {
+            }
+        }
         if (chi_square < GOOD_ENOUGH_THRESHOLD) {
-            *found_good_enough = true;
+            if (index < worker->good_index) {
+                worker->good_index = index;
+                worker->good_chi_square = chi_square;
+                strcpy(worker->good_key, worker->key);
+            }
+            size_t first = atomic_load_explicit(pass->first_good, memory_order_relaxed);
+            while (index < first && !atomic_compare_exchange_weak(pass->first_good, &first, index)) {
+            }
+            return false;
         }
+    }
+    return true;
+}
 
-        free(plain_text);
-        return;
+/**
+ * @brief Takes the next task from the worker's own range, or steals half of the largest other range.
+ *
+ * @param worker The worker.
+ * @param task Receives the task number.
+ * @return false once every range is empty.
+ */
+static bool next_brute_force_task(brute_force_worker *worker, size_t *task) {
+    for (;;) {
+        pthread_mutex_lock(&worker->lock);
+        if (worker->next < worker->end) {
+            *task = worker->next++;
+            pthread_mutex_unlock(&worker->lock);
+            return true;
+        }
+        pthread_mutex_unlock(&worker->lock);
+
+        brute_force_worker *victim = NULL;
+        size_t largest = 0;
+        for (int i = 0; i < worker->worker_count; i++) {
+            brute_force_worker *other = &worker->workers[i];
+            pthread_mutex_lock(&other->lock);
+            size_t remaining = other->end - other->next;
+            pthread_mutex_unlock(&other->lock);
+            if (other != worker && remaining > largest) {
+                largest = remaining;
+                victim = other;
+            }
+        }
+        if (victim == NULL) {
+            return false;
+        }
+
+        // The owner works from the front of its range, so a thief takes the back half.
+        pthread_mutex_lock(&victim->lock);
+        size_t remaining = victim->end - victim->next;
+        size_t stolen_from = victim->end - (remaining + 1) / 2;
+        size_t stolen_to = victim->end;
+        victim->end = remaining > 0 ? stolen_from : victim->end;
+        pthread_mutex_unlock(&victim->lock);
+        if (remaining > 0) {
+            pthread_mutex_lock(&worker->lock);
+            worker->next = stolen_from;
+            worker->end = stolen_to;
+            pthread_mutex_unlock(&worker->lock);
+        }
     }
+}
 
-    for (char c = 'A'; c <= 'Z'; c++) {
-        key[position] = c;
-        generate_keys(key, position + 1, max_length, cipher_text, best_key, best_plain_text, best_chi_square, found_good_enough);
-        if (*found_good_enough) return;
+/**
+ * @brief Runs one worker of a parallel brute-force pass until no tasks are left.
+ *
+ * @param arg The brute_force_worker.
+ * @return NULL.
+ */
+static void *brute_force_worker_main(void *arg) {
+    brute_force_worker *worker = arg;
+    brute_force_pass *pass = worker->pass;
+    size_t task_size = pass->subtree_sizes[pass->prefix_length];
+    size_t task;
+    while (next_brute_force_task(worker, &task)) {
+        size_t index = pass->first_index + task * task_size;
+        if (index >= pass->limit || index > atomic_load_explicit(pass->first_good, memory_order_relaxed)) {
+            continue;
+        }
+        size_t prefix = task;
+        for (int position = pass->prefix_length - 1; position >= 0; position--) {
+            worker->key[position] = (char)('A' + prefix % ALPHABET_SIZE);
+            prefix /= ALPHABET_SIZE;
+        }
+        for (int position = 0; position < pass->prefix_length; position++) {
+            int shift = worker->key[position] - 'A';
+            for (int i = 0; i < ALPHABET_SIZE; i++) {
+                worker->plain_counts[position + 1][i] = worker->plain_counts[position][i] + pass->columns[position][(i + shift) % ALPHABET_SIZE];
+            }
+        }
+        if (pass->prune && pass->prefix_length > 0 && !brute_force_prefix_can_win(worker, pass->prefix_length)) {
+            continue;
+        }
+        search_key_suffix(worker, pass->prefix_length, index);
     }
+    return NULL;
 }
 
 /**
- * @brief Finds the best key for decrypting the ciphertext using brute force.
+ * @brief Runs the parallel passes of a brute-force search, one per key length.
+ *
+ * @param workers The workers, with their rankings and good-enough keys reset.
+ * @param count The number of workers.
+ * @param counts The ciphertext column histograms of every key length, from count_key_columns.
+ * @param total_letters The number of letters in the ciphertext.
+ * @param prune Whether to prune key prefixes.
+ * @param limit Candidates from this number on are not searched.
+ * @param key_length Receives the first key length not searched.
+ * @return The number of candidates in the key lengths searched.
+ */
+static size_t run_brute_force_passes(brute_force_worker *workers, int count, size_t (*counts)[MAX_KEY_LENGTH][ALPHABET_SIZE],
+                                     size_t total_letters, bool prune, size_t limit, int *key_length) {
+    atomic_size_t first_good = SIZE_MAX;
+    _Atomic double prune_threshold = INFINITY;
+    size_t first_index = 0;
+    for (*key_length = MIN_KEY_LENGTH; *key_length <= MAX_KEY_LENGTH && first_index < limit && atomic_load(&first_good) == SIZE_MAX; (*key_length)++) {
+        brute_force_pass pass = { .columns = counts[*key_length], .key_length = *key_length,
+                                  .first_index = first_index, .limit = limit, .first_good = &first_good,
+                                  .prune_threshold = &prune_threshold, .prune = prune, .total_letters = total_letters };
+        pass.prefix_length = *key_length > TASK_SUFFIX_LETTERS ? *key_length - TASK_SUFFIX_LETTERS : 0;
+        pass.subtree_sizes[*key_length] = 1;
+        for (int position = *key_length - 1; position >= 0; position--) {
+            pass.subtree_sizes[position] = pass.subtree_sizes[position + 1] * ALPHABET_SIZE;
+        }
+        size_t task_size = pass.subtree_sizes[pass.prefix_length];
+        size_t tasks = pass.subtree_sizes[0] / task_size;
+        size_t within_budget = (limit - first_index) / task_size + ((limit - first_index) % task_size != 0);
+        if (within_budget < tasks) {
+            tasks = within_budget;
+        }
+
+        int active = tasks < (size_t)count ? (int)tasks : count;
+        pthread_t ids[BRUTE_FORCE_MAX_THREADS];
+        bool started[BRUTE_FORCE_MAX_THREADS] = {false};
+        for (int i = 0; i < active; i++) {
+            workers[i].pass = &pass;
+            workers[i].key[*key_length] = '\0';
+            workers[i].worker_count = active;
+            workers[i].next = tasks * (size_t)i / (size_t)active;
+            workers[i].end = tasks * (size_t)(i + 1) / (size_t)active;
+        }
+        // A worker that fails to start leaves its tasks to be stolen by the others.
+        for (int i = 1; i < active; i++) {
+            started[i] = pthread_create(&ids[i], NULL, brute_force_worker_main, &workers[i]) == 0;
+        }
+        brute_force_worker_main(&workers[0]);
+        for (int i = 1; i < active; i++) {
+            if (started[i]) {
+                pthread_join(ids[i], NULL);
+            }
+        }
+        first_index += pass.subtree_sizes[0];
+    }
+
+    return first_index;
+}
+
+/**
+ * @brief Finds the best key like find_best_key_brute_force, using several threads.
  *
  * @param cipher_text Pointer to the null-terminated string containing the ciphertext to decrypt.
  * @param best_key Pointer to the buffer where the best key will be stored.
  * @param best_plain_text Pointer to the buffer where the decrypted text will be stored.
+ * @param stats Pointer to the candidate budget and search counters, or NULL for an unlimited search.
+ * @param threads The maximum number of threads to use, including the caller.
+ *
+ * Each key length is searched in one parallel pass. Its candidates are split into tasks
+ * that fix all but the last few letters, and each worker starts with an equal run of
+ * tasks; a worker that runs out steals the back half of the largest remaining run.
+ *
+ * The result is the serial one. The serial search stops at the first key, in its order,
+ * that scores below GOOD_ENOUGH_THRESHOLD, and every key before that scores above it, so
+ * that key is the answer when there is one. Workers share the number of the earliest
+ * such key found so far and abandon tasks that come after it. Otherwise the answer is the
+ * lowest score within the budget, the earliest on ties. Candidate numbers also give the
+ * serial candidate count and budget outcome. If memory cannot be allocated the search
+ * runs serially.
+ *
+ * Each worker ranks the keys it scores, and the rankings are merged by score and then
+ * candidate number, as the serial search ranks them. A good-enough key makes the serial
+ * ranking that key and the best keys before it, but keys after it may already have pushed
+ * those out of a worker's ranking, so a ranking of more than one key is then searched
+ * again in parallel with the budget ending at the good-enough key.
  */
-void find_best_key_brute_force(const char *cipher_text, char *best_key, char *best_plain_text) {
-    double best_chi_square = INFINITY;
-    char key[MAX_KEY_LENGTH + 1] = {0};
-    bool found_good_enough = false;
+void find_best_key_brute_force_parallel(const char *cipher_text, char *best_key, char *best_plain_text, vigenere_crack_stats *stats, int threads) {
+    vigenere_crack_stats unlimited = {0};
+    if (stats == NULL) {
+        stats = &unlimited;
+    }
+    vigenere_key_score best;
+    key_ranking ranking = { stats->top != NULL ? stats->top : &best, stats->top != NULL ? stats->top_size : 1, 0 };
+    int count = threads < BRUTE_FORCE_MAX_THREADS ? threads : BRUTE_FORCE_MAX_THREADS;
+    brute_force_worker *workers = count > 1 ? calloc((size_t)count, sizeof(*workers)) : NULL;
+    vigenere_key_score *kept = workers != NULL ? calloc((size_t)count * (size_t)ranking.size, sizeof(*kept)) : NULL;
+    if (kept == NULL) {
+        free(workers);
+        find_best_key_brute_force(cipher_text, best_key, best_plain_text, stats);
+        return;
+    }
 
-    for (int key_length = MIN_KEY_LENGTH; key_length <= MAX_KEY_LENGTH; key_length++) {
-        generate_keys(key, 0, key_length, cipher_text, best_key, best_plain_text, &best_chi_square, &found_good_enough);
-        if (found_good_enough) break;
+    size_t counts[MAX_KEY_LENGTH + 1][MAX_KEY_LENGTH][ALPHABET_SIZE];
+    size_t total_letters = count_key_columns(cipher_text, counts);
+    size_t limit = stats->max_candidates != 0 ? stats->max_candidates : SIZE_MAX;
+    for (int i = 0; i < count; i++) {
+        workers[i].workers = (struct brute_force_worker *)workers;
+        workers[i].worker_count = count;
+        workers[i].ranking = (key_ranking){ kept + (size_t)i * (size_t)ranking.size, ranking.size, 0 };
+        workers[i].good_index = SIZE_MAX;
+        pthread_mutex_init(&workers[i].lock, NULL);
+    }
+
+    int key_length;
+    size_t first_index = run_brute_force_passes(workers, count, counts, total_letters, stats->prune, limit, &key_length);
+    size_t good_index = SIZE_MAX;
+    for (int i = 0; i < count; i++) {
+        if (workers[i].good_index < good_index) {
+            good_index = workers[i].good_index;
+        }
+    }
+    // Keys after the good-enough one may have pushed earlier keys out of a worker's
+    // ranking. Searching again with the budget ending at that key scores none of them,
+    // and the counters report that search alone.
+    if (good_index != SIZE_MAX && ranking.size > 1) {
+        for (int i = 0; i < count; i++) {
+            workers[i].ranking.count = 0;
+            workers[i].good_index = SIZE_MAX;
+            workers[i].scored = workers[i].nodes_visited = workers[i].nodes_pruned = 0;
+        }
+        limit = good_index + 1;
+        first_index = run_brute_force_passes(workers, count, counts, total_letters, stats->prune, limit, &key_length);
+    }
+
+    stats->scored = stats->nodes_visited = stats->nodes_pruned = 0;
+    for (int i = 0; i < count; i++) {
+        stats->scored += workers[i].scored;
+        stats->nodes_visited += workers[i].nodes_visited;
+        stats->nodes_pruned += workers[i].nodes_pruned;
+        if (good_index != SIZE_MAX && ranking.size == 1) {
+            if (workers[i].good_index == good_index) {
+                ranking_add(&ranking, workers[i].good_key, workers[i].good_chi_square, good_index);
+            }
+        } else {
+            for (int j = 0; j < workers[i].ranking.count; j++) {
+                const vigenere_key_score *entry = &workers[i].ranking.keys[j];
+                ranking_add(&ranking, entry->key, entry->chi_square, entry->candidate);
+            }
+        }
+        pthread_mutex_destroy(&workers[i].lock);
+    }
+    free(kept);
+    free(workers);
+
+    // The serial search runs out of budget when it reaches a candidate beyond it.
+    if (good_index != SIZE_MAX) {
+        stats->candidates = good_index + 1;
+        stats->budget_exhausted = false;
+    } else {
+        stats->candidates = first_index < limit ? first_index : limit;
+        stats->budget_exhausted = first_index > limit || (first_index == limit && key_length <= MAX_KEY_LENGTH);
+    }
+    ranking_sort(&ranking);
+    stats->top_count = ranking.count;
+    stats->best_chi_square = ranking.count > 0 ? ranking.keys[0].chi_square : INFINITY;
+    if (ranking.count > 0) {
+        strcpy(best_key, ranking.keys[0].key);
+        if (best_plain_text != NULL) {
+            vigenere_crack_decrypt(best_key, cipher_text, best_plain_text);
+        }
+    }
+}
+
+/**
+ * @brief The scratch memory of one key-length search, carved from a single allocation.
+ *
+ * Everything is sized from the ciphertext length and the longest key length up front, so
+ * the search itself makes no heap calls.
+ */
+typedef struct {
+    void *base;                         // the allocation everything below points into
+    size_t *matches;                    // coincidences at each shift, 1 to shifts
+    size_t *pairs;                      // letter pairs compared at each shift
+    period_score *scores;               // a score for each key length, 1 to max_period
+    size_t *period_pairs;               // the letter pairs behind each of those scores
+    unsigned char *letters;             // the ciphertext letters as indices, up to text_length of them
+} column_search;
+
+/**
+ * @brief Returns the number of shifts score_periods counts coincidences at.
+ *
+ * @param count The number of letters (or an upper bound on it).
+ * @param max_period The longest key length to consider.
+ */
+static size_t autocorrelation_shifts(size_t count, int max_period) {
+    size_t shifts = count / 2 < AUTOCORRELATION_SHIFTS ? count / 2 : AUTOCORRELATION_SHIFTS;
+    return shifts < (size_t)max_period ? (size_t)max_period : shifts;
+}
+
+/**
+ * @brief Allocates the scratch memory for searching a ciphertext's key length.
+ *
+ * @param search The search to set up.
+ * @param text_length The length of the ciphertext.
+ * @param max_period The longest key length to consider.
+ * @return 0 on success, -1 if memory allocation fails.
+ *
+ * The word-sized arrays come first, so each stays aligned; the letters go last.
+ */
+static int column_search_init(column_search *search, size_t text_length, int max_period) {
+    size_t shifts = autocorrelation_shifts(text_length, max_period);
+    size_t scores_size = sizeof(*search->scores) * (size_t)max_period;
+    size_t period_pairs_size = sizeof(*search->period_pairs) * (size_t)max_period;
+    size_t shifts_size = sizeof(size_t) * (shifts + 1);
+    unsigned char *base = malloc(2 * shifts_size + scores_size + period_pairs_size + text_length + 1);
+    if (base == NULL) {
+        return -1;
+    }
+    unsigned char *next = base;
+    search->base = base;
+    search->matches = (size_t *)next;
+    search->pairs = (size_t *)(next += shifts_size);
+    search->scores = (period_score *)(next += shifts_size);
+    search->period_pairs = (size_t *)(next += scores_size);
+    search->letters = next + period_pairs_size;
+    return 0;
+}
+
+/**
+ * @brief Extracts the letters of a text as indices, in order.
+ *
+ * @param text Pointer to the null-terminated text.
+ * @param letters Receives the letter indices (0 for A or a); at least strlen(text) bytes.
+ * @return The number of letters.
+ *
+ * Only letters advance the key, so the key column of a letter is its index in this
+ * sequence, not its position in the text.
+ */
+static size_t extract_letters(const char *text, unsigned char *letters) {
+    size_t n = 0;
+    for (const char *p = text; *p; p++) {
+        if (isalpha((unsigned char)*p)) {
+            letters[n++] = (unsigned char)(tolower((unsigned char)*p) - 'a');
+        }
+    }
+    return n;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+/**
+ * @brief Counts the positions where two byte sequences hold the same value, 16 at a time.
+ *
+ * @param a The first sequence.
+ * @param b The second sequence.
+ * @param len The number of positions to compare.
+ * @return The number of equal positions.
+ *
+ * Equal lanes are counted in byte accumulators by subtracting the all-ones compare mask,
+ * and the accumulators are summed with psadbw before any lane can overflow.
+ */
+static size_t count_matches(const unsigned char *a, const unsigned char *b, size_t len) {
+    size_t matches = 0;
+    size_t i = 0;
+    while (i + 16 <= len) {
+        __m128i counts = _mm_setzero_si128();
+        for (int block = 0; block < 255 && i + 16 <= len; block++, i += 16) {
+            __m128i equal = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(a + i)),
+                                           _mm_loadu_si128((const __m128i *)(b + i)));
+            counts = _mm_sub_epi8(counts, equal);
+        }
+        __m128i sums = _mm_sad_epu8(counts, _mm_setzero_si128());
+        matches += (size_t)_mm_cvtsi128_si32(sums) + (size_t)_mm_extract_epi16(sums, 4);
+    }
+    for (; i < len; i++) {
+        matches += a[i] == b[i];
+    }
+    return matches;
+}
+#else
+static size_t count_matches(const unsigned char *a, const unsigned char *b, size_t len) {
+    size_t matches = 0;
+    for (size_t i = 0; i < len; i++) {
+        matches += a[i] == b[i];
+    }
+    return matches;
+}
+#endif
+
+/**
+ * @brief Orders ranked key lengths by tier, then by bound, best first, then shortest first.
+ */
+static int compare_period_ranks(const void *a, const void *b) {
+    const period_score *x = a, *y = b;
+    if (x->tier != y->tier) {
+        return x->tier - y->tier;
+    }
+    if (x->bound != y->bound) {
+        return x->bound < y->bound ? 1 : -1;
+    }
+    return x->period - y->period;
+}
+
+/**
+ * @brief Returns the score at which a key length looks like a key.
+ *
+ * @param scores The score of each period from 1 to max_period.
+ * @param max_period The longest key length considered.
+ * @return ENGLISH_IOC_THRESHOLD if any period reaches it, which happens once there is
+ *         enough text; otherwise PERIOD_IOC_TOLERANCE of the best score.
+ */
+static double period_acceptance(const period_score *scores, int max_period) {
+    double best = 0.0;
+    for (int period = 1; period <= max_period; period++) {
+        if (scores[period - 1].score >= ENGLISH_IOC_THRESHOLD) {
+            return ENGLISH_IOC_THRESHOLD;
+        }
+        if (scores[period - 1].score > best) {
+            best = scores[period - 1].score;
+        }
+    }
+    return best * PERIOD_IOC_TOLERANCE;
+}
+
+/**
+ * @brief Scores every candidate key length of a letter sequence by coincidence autocorrelation.
+ *
+ * @param search The search, whose letters hold the ciphertext letters and whose matches and pairs are scratch space.
+ * @param count The number of letters.
+ * @param max_period The longest key length to consider.
+ * @param scores Receives scores[p - 1] for each period p from 1 to max_period, unsorted.
+ * @return The estimated key length. search->period_pairs receives the number of pairs behind each score.
+ *
+ * Letters a multiple of the key length apart were enciphered with the same key letter,
+ * so they coincide about as often as two letters of English (0.066); other pairs
+ * coincide about as often as random letters (0.038). Coincidences are counted at every
+ * shift up to max_period, and further (up to AUTOCORRELATION_SHIFTS, or half the text)
+ * so that short periods are scored from as many pairs as the column index of coincidence
+ * would use. Each shift compares at most AUTOCORRELATION_SAMPLE pairs. A period scores
+ * the coincidence rate of all pairs at its multiples.
+ *
+ * Multiples of the key length score as well as the key length itself, so the shortest
+ * period that looks like a key (see period_acceptance) is chosen. Periods with fewer
+ * than PERIOD_MIN_PAIRS pairs are too noisy to score.
+ */
+static int score_periods(const column_search *search, size_t count, int max_period, period_score *scores) {
+    size_t shifts = autocorrelation_shifts(count, max_period);
+    const unsigned char *letters = search->letters;
+    size_t *matches = search->matches, *pairs = search->pairs;
+    for (size_t shift = 1; shift <= shifts; shift++) {
+        pairs[shift] = shift < count ? count - shift : 0;
+        if (pairs[shift] > AUTOCORRELATION_SAMPLE) {
+            pairs[shift] = AUTOCORRELATION_SAMPLE;
+        }
+        matches[shift] = count_matches(letters, letters + shift, pairs[shift]);
+    }
+
+    for (int period = 1; period <= max_period; period++) {
+        size_t period_matches = 0, period_pairs = 0;
+        for (size_t shift = (size_t)period; shift <= shifts; shift += (size_t)period) {
+            period_matches += matches[shift];
+            period_pairs += pairs[shift];
+        }
+        scores[period - 1].period = period;
+        scores[period - 1].score = period_pairs < PERIOD_MIN_PAIRS ? 0.0 : (double)period_matches / period_pairs;
+        search->period_pairs[period - 1] = period_pairs;
+    }
+
+    double acceptance = period_acceptance(scores, max_period);
+    for (int period = 1; period <= max_period; period++) {
+        if (scores[period - 1].score >= acceptance) {
+            return period;
+        }
     }
+    return 1;
+}
+
+/**
+ * @brief Ranks the candidate key lengths of a Vigenere ciphertext.
+ *
+ * @param cipher_text Pointer to the null-terminated ciphertext.
+ * @param max_period The longest key length to consider; may be in the thousands.
+ * @param ranked Receives max_period entries, most likely first.
+ * @return The estimated key length (see score_periods), or -1 if memory allocation fails.
+ *
+ * Key lengths that look like a key come first, then their multiples, which decrypt as
+ * well as the key length they repeat, then the rest. Each tier is ordered by the score
+ * less PERIOD_RANK_Z standard errors, so that long key lengths, which are scored from
+ * few pairs, do not rank high by chance.
+ */
+int rank_periods(const char *cipher_text, int max_period, period_score *ranked) {
+    column_search search;
+    if (column_search_init(&search, strlen(cipher_text), max_period) != 0) {
+        return -1;
+    }
+    size_t count = extract_letters(cipher_text, search.letters);
+    int period = score_periods(&search, count, max_period, search.scores);
+
+    double acceptance = period_acceptance(search.scores, max_period);
+    for (int i = 0; i < max_period; i++) {
+        ranked[i] = search.scores[i];
+        ranked[i].tier = PERIOD_OTHER;
+        double score = search.scores[i].score;
+        size_t pairs = search.period_pairs[i];
+        ranked[i].bound = pairs > 0 ? score - PERIOD_RANK_Z * sqrt(score * (1 - score) / pairs) : 0.0;
+    }
+    for (int i = 0; i < max_period; i++) {
+        if (ranked[i].tier == PERIOD_OTHER && ranked[i].score >= acceptance) {
+            ranked[i].tier = PERIOD_KEY;
+            for (int multiple = 2 * (i + 1); multiple <= max_period; multiple += i + 1) {
+                ranked[multiple - 1].tier = PERIOD_MULTIPLE;
+            }
+        }
+    }
+    qsort(ranked, (size_t)max_period, sizeof(*ranked), compare_period_ranks);
+    free(search.base);
+    return period;
+}
+
+/**
+ * @brief Finds the best key by estimating the key length and solving each key letter separately.
+ *
+ * @param cipher_text Pointer to the null-terminated string containing the ciphertext to decrypt.
+ * @param max_period The longest key length to consider.
+ * @param best_key Pointer to the buffer where the best key will be stored; at least max_period + 1 bytes.
+ * @param best_plain_text Pointer to the buffer where the decrypted text will be stored.
+ * @param stats Pointer to the search counters, or NULL. The candidate budget is ignored, since the search is already bounded.
+ * @return 0 on success, -1 if memory allocation fails.
+ *
+ * Once the key length is known, the letters enciphered with each key letter form a
+ * Caesar ciphertext of their own, so each key letter is the shift whose decryption of its
+ * column has the lowest chi-square; the 26 shifts of a column are scored together from
+ * its histogram. The text is read once to extract its letters, which are then scanned
+ * once per candidate shift for the key length and once to build the column histograms,
+ * and the text is decrypted once with the result. The scratch memory of the key-length
+ * search is allocated once, up front, and the histograms once the key length is known.
+ */
+int find_best_key_columns(const char *cipher_text, int max_period, char *best_key, char *best_plain_text, vigenere_crack_stats *stats) {
+    vigenere_crack_stats unlimited = {0};
+    if (stats == NULL) {
+        stats = &unlimited;
+    }
+    stats->candidates = 0;
+    stats->budget_exhausted = false;
+
+    column_search search;
+    if (column_search_init(&search, strlen(cipher_text), max_period) != 0) {
+        return -1;
+    }
+    size_t count = extract_letters(cipher_text, search.letters);
+    int period = score_periods(&search, count, max_period, search.scores);
+
+    size_t (*counts)[ALPHABET_SIZE] = calloc((size_t)period, sizeof(*counts));
+    if (counts == NULL) {
+        free(search.base);
+        return -1;
+    }
+    for (size_t i = 0, column = 0; i < count; i++) {
+        counts[column][search.letters[i]]++;
+        if (++column == (size_t)period) {
+            column = 0;
+        }
+    }
+
+    size_t plain_counts[ALPHABET_SIZE] = {0};
+    const size_t no_counts[ALPHABET_SIZE] = {0};
+    for (int column = 0; column < period; column++) {
+        size_t column_letters = 0;
+        for (int i = 0; i < ALPHABET_SIZE; i++) {
+            column_letters += counts[column][i];
+        }
+        double chi_squares[ALPHABET_SIZE];
+        chi_square_of_last_letters(no_counts, counts[column], column_letters, chi_squares);
+        int best_shift = 0;
+        for (int shift = 0; shift < ALPHABET_SIZE; shift++) {
+            stats->candidates++;
+            if (chi_squares[shift] < chi_squares[best_shift]) {
+                best_shift = shift;
+            }
+        }
+        best_key[column] = (char)('A' + best_shift);
+        for (int i = 0; i < ALPHABET_SIZE; i++) {
+            plain_counts[i] += counts[column][(i + best_shift) % ALPHABET_SIZE];
+        }
+    }
+    best_key[period] = '\0';
+
+    vigenere_crack_decrypt(best_key, cipher_text, best_plain_text);
+    stats->best_chi_square = chi_square_of_counts(plain_counts);
+    free(counts);
+    free(search.base);
+    return 0;
 }
 
 /**
@@ -207,6 +1248,63 @@ void validate_output(const char *plain_text) {
     printf("Valid words found: %d\n", valid_word_count);
 }
 
+/**
+ * @brief Prints a ranking of keys, each with the start of its decryption.
+ *
+ * @param cipher_text Pointer to the null-terminated ciphertext.
+ * @param top The keys, best first.
+ * @param count The number of keys.
+ * @return 0 on success, -1 if memory allocation fails.
+ *
+ * Decryption leaves whitespace alone, so the first RANKED_PREVIEW_WORDS words end at the
+ * same place for every key; only that prefix is decrypted, once per key printed.
+ */
+int print_ranked_keys(const char *cipher_text, const vigenere_key_score *top, int count) {
+    int word_count = 0;
+    size_t preview_length = 0;
+    for (; cipher_text[preview_length] != '\0'; preview_length++) {
+        if (isspace((unsigned char)cipher_text[preview_length]) && ++word_count >= RANKED_PREVIEW_WORDS) {
+            break;
+        }
+    }
+    char *preview = malloc(preview_length + 1);
+    if (!preview) {
+        return -1;
+    }
+
+    printf("Top %d keys:\n", count);
+    for (int i = 0; i < count; i++) {
+        decrypt_prefix(top[i].key, cipher_text, preview_length, preview);
+        printf("  %d. %s (chi-square %.2f): %s\n", i + 1, top[i].key, top[i].chi_square, preview);
+    }
+    free(preview);
+    return 0;
+}
+
+#ifndef CRACK_NO_MAIN
+/** Largest value accepted for --max-period, --periods and --top. */
+#define MAX_OPTION_VALUE 1000000
+
+/**
+ * @brief Parses a command-line option value as a decimal integer within a range.
+ *
+ * @param text The option value.
+ * @param min The smallest value accepted.
+ * @param max The largest value accepted.
+ * @param value Receives the value.
+ * @return true if the whole of text is an integer from min to max.
+ */
+static bool parse_int_option(const char *text, long min, long max, int *value) {
+    char *end;
+    errno = 0;
+    long parsed = strtol(text, &end, 10);
+    if (end == text || *end != '\0' || errno == ERANGE || parsed < min || parsed > max) {
+        return false;
+    }
+    *value = (int)parsed;
+    return true;
+}
+
 /**
  * @brief Main function for the program.
  *
@@ -214,16 +1312,43 @@ void validate_output(const char *plain_text) {
  * @param argv The array of command-line arguments.
  * @return EXIT_SUCCESS if the program completes successfully, EXIT_FAILURE otherwise.
  *
- * This function reads a ciphertext from a file, finds the best key using brute force, 
- * decrypts the ciphertext, and validates the output.
+ * This function reads a ciphertext from a file, finds the best key by estimating the key
+ * length and solving each key letter (or, with --brute-force, by trying every key),
+ * decrypts the ciphertext, and validates the output. --max-period sets the longest key
+ * length considered, --periods prints the best-scoring key lengths first, and --threads
+ * spreads the brute-force search over several threads. The brute force prunes key
+ * prefixes that cannot win and reports how much of the key space it scored; --top ranks
+ * its best keys and previews each.
  */
 int main(int argc, char *argv[]) {
-    if (argc != 2) {
-        fprintf(stderr, "Usage: %s <ciphertext_file>\n", argv[0]);
+    bool brute_force = false;
+    int max_period = MAX_KEY_LENGTH;
+    int show_periods = 0;
+    int threads = 1;
+    int top_size = 0;
+    int arg = 1;
+    for (; arg < argc - 1; arg++) {
+        if (strcmp(argv[arg], "--brute-force") == 0) {
+            brute_force = true;
+        } else if (strcmp(argv[arg], "--max-period") == 0 && arg + 1 < argc - 1) {
+            if (!parse_int_option(argv[++arg], 1, MAX_OPTION_VALUE, &max_period)) break;
+        } else if (strcmp(argv[arg], "--periods") == 0 && arg + 1 < argc - 1) {
+            if (!parse_int_option(argv[++arg], 0, MAX_OPTION_VALUE, &show_periods)) break;
+        } else if (strcmp(argv[arg], "--threads") == 0 && arg + 1 < argc - 1) {
+            if (!parse_int_option(argv[++arg], 1, BRUTE_FORCE_MAX_THREADS, &threads)) break;
+        } else if (strcmp(argv[arg], "--top") == 0 && arg + 1 < argc - 1) {
+            if (!parse_int_option(argv[++arg], 1, MAX_OPTION_VALUE, &top_size)) break;
+        } else {
+            break;
+        }
+    }
+    if (arg != argc - 1
+        || (brute_force && max_period != MAX_KEY_LENGTH) || (!brute_force && (threads != 1 || top_size != 0))) {
+        fprintf(stderr, "Usage: %s [--brute-force [--threads N] [--top K] | --max-period N] [--periods K] <ciphertext_file>\n", argv[0]);
         return EXIT_FAILURE;
     }
 
-    FILE *file = fopen(argv[1], "r");
+    FILE *file = fopen(argv[argc - 1], "r");
     if (!file) {
         perror("Failed to open file");
         return EXIT_FAILURE;
@@ -251,17 +1376,76 @@ int main(int argc, char *argv[]) {
         return EXIT_FAILURE;
     }
 
-    char best_key[MAX_KEY_LENGTH + 1] = {0};
+    char *best_key = calloc((size_t)max_period + 1, 1);
+    period_score *ranked = show_periods > 0 ? malloc(sizeof(period_score) * (size_t)max_period) : NULL;
+    vigenere_key_score *top = top_size > 0 ? malloc(sizeof(vigenere_key_score) * (size_t)top_size) : NULL;
+    if (!best_key || (show_periods > 0 && !ranked) || (top_size > 0 && !top)) {
+        perror("Failed to allocate memory");
+        free(top);
+        free(ranked);
+        free(best_key);
+        free(best_plain_text);
+        free(cipher_text);
+        return EXIT_FAILURE;
+    }
 
-    find_best_key_brute_force(cipher_text, best_key, best_plain_text);
+    if (show_periods > 0) {
+        if (rank_periods(cipher_text, max_period, ranked) < 0) {
+            perror("Failed to allocate memory");
+            free(top);
+            free(ranked);
+            free(best_key);
+            free(best_plain_text);
+            free(cipher_text);
+            return EXIT_FAILURE;
+        }
+        printf("Key length scores:\n");
+        for (int i = 0; i < show_periods && i < max_period; i++) {
+            static const char *const tiers[] = { "key", "multiple", "other" };
+            printf("  %d: %.4f (bound %.4f, %s)\n", ranked[i].period, ranked[i].score, ranked[i].bound,
+                   tiers[ranked[i].tier]);
+        }
+    }
+
+    int status = 0;
+    vigenere_crack_stats stats = { .prune = true, .top = top, .top_size = top_size };
+    if (brute_force) {
+        struct timespec start, end;
+        timespec_get(&start, TIME_UTC);
+        find_best_key_brute_force_parallel(cipher_text, best_key, best_plain_text, &stats, threads);
+        timespec_get(&end, TIME_UTC);
+        double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+        printf("Keys searched: %zu, scored: %zu (%.0f per second), prefixes pruned: %zu of %zu\n", stats.candidates,
+               stats.scored, seconds > 0 ? stats.scored / seconds : 0.0, stats.nodes_pruned, stats.nodes_visited);
+    } else {
+        status = find_best_key_columns(cipher_text, max_period, best_key, best_plain_text, NULL);
+    }
+    if (status != 0) {
+        perror("Failed to allocate memory");
+        free(top);
+        free(ranked);
+        free(best_key);
+        free(best_plain_text);
+        free(cipher_text);
+        return EXIT_FAILURE;
+    }
 
     printf("Best key: %s\n", best_key);
     printf("Decrypted output:\n%s\n", best_plain_text);
 
     validate_output(best_plain_text);
 
+    if (top != NULL && print_ranked_keys(cipher_text, top, stats.top_count) != 0) {
+        perror("Failed to allocate memory");
+        status = -1;
+    }
+
+    free(top);
+    free(ranked);
+    free(best_key);
     free(best_plain_text);
     free(cipher_text);
 
-    return EXIT_SUCCESS;
+    return status == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
 }
+#endif
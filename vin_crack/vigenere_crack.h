@@ -0,0 +1,117 @@
+#ifndef VIGENERE_CRACK_H
+#define VIGENERE_CRACK_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#define MAX_KEY_LENGTH 10
+#define ALPHABET_SIZE 26
+
+/** A candidate key and its score. */
+typedef struct {
+    char key[MAX_KEY_LENGTH + 1];
+    double chi_square;      /**< Lower is better. */
+    size_t candidate;       /**< Its number in the search order, from 0; breaks ties in favour of the earlier key. */
+} vigenere_key_score;
+
+/** Limits and counters for one key search. */
+typedef struct {
+    size_t max_candidates;  /**< Give up after this many candidate keys; 0 for no limit. */
+    bool prune;             /**< Skip key prefixes that cannot win (brute force only); the result is unchanged. */
+    size_t candidates;      /**< The number of candidate keys searched, including those ruled out by pruning. */
+    size_t scored;          /**< The number of candidate keys actually scored. */
+    size_t nodes_visited;   /**< The number of key prefixes whose lower bound was checked. */
+    size_t nodes_pruned;    /**< The number of those prefixes cut off. */
+    double best_chi_square; /**< The chi-square statistic of the best key found. */
+    bool budget_exhausted;  /**< True if the search stopped at `max_candidates`. */
+    vigenere_key_score *top; /**< If not NULL, receives the `top_size` best keys scored, best first (brute force only). */
+    int top_size;           /**< The capacity of `top`, at least 1. */
+    int top_count;          /**< The number of keys in `top`. */
+} vigenere_crack_stats;
+
+/** Decrypt `cipher_text` with `key`, keeping case. Only letters consume key characters.
+  *
+  * \param plain_text A buffer of at least strlen(cipher_text) + 1 bytes.
+  */
+void vigenere_crack_decrypt(const char * key, const char * cipher_text, char * plain_text);
+
+/** The chi-square statistic of a letter histogram (A first) against English; lower is better. */
+double chi_square_of_counts(const size_t counts[ALPHABET_SIZE]);
+
+/** The chi-square statistic of the letters of `text` against English; lower is better. */
+double calculate_chi_square(const char * text);
+
+/** Try every key of length 1 to MAX_KEY_LENGTH, shortest first, and keep the one whose
+  * decryption is closest to English. The search stops early once a key scores below
+  * the good-enough threshold, or when the candidate budget in `stats` runs out.
+  * With `stats->prune`, key prefixes whose chi-square lower bound already loses to the
+  * best key are skipped; they count towards `candidates` but not `scored`.
+  *
+  * With `stats->top`, the best `top_size` keys are kept in a heap of (key, score) pairs
+  * and pruning compares against the worst of them; nothing is decrypted but the winner.
+  *
+  * \param best_key A buffer of at least MAX_KEY_LENGTH + 1 bytes.
+  * \param best_plain_text A buffer of at least strlen(cipher_text) + 1 bytes, or NULL to
+  *        skip decrypting the ciphertext.
+  * \param stats The candidate budget, and receives the search counters; may be NULL for
+  *        an unlimited search.
+  */
+void find_best_key_brute_force(const char * cipher_text, char * best_key, char * best_plain_text,
+                               vigenere_crack_stats * stats);
+
+/** Run `find_best_key_brute_force` on up to `threads` threads, including the caller.
+  * Each key length is split into subtrees of keys sharing a prefix, which idle threads
+  * steal from busy ones. The key, plaintext, `candidates` and `budget_exhausted` are
+  * identical to the serial search's, including the early stop and the candidate budget;
+  * with pruning, how many keys are scored and prefixes pruned depends on scheduling.
+  * `top` is identical too: when a good-enough key ends a search that ranks more than one
+  * key, the search is repeated in parallel with the budget ending at that key.
+  */
+void find_best_key_brute_force_parallel(const char * cipher_text, char * best_key, char * best_plain_text,
+                                        vigenere_crack_stats * stats, int threads);
+
+/** A candidate key length and its coincidence score: the mean rate at which letters a
+  * multiple of `period` apart are equal. About 0.066 for the right key length (as in
+  * English) and 0.038 for a wrong one (as in random letters).
+  */
+typedef struct {
+    int period;
+    double score;
+    double bound;   /**< the score less two standard errors; set by `rank_periods` only */
+    int tier;       /**< a `period_tier`; set by `rank_periods` only */
+} period_score;
+
+/** The groups `rank_periods` lists key lengths in, in order. */
+enum period_tier {
+    PERIOD_KEY,         /**< scores like English, and is no multiple of a shorter such length */
+    PERIOD_MULTIPLE,    /**< a multiple of a `PERIOD_KEY` length, which decrypts as well */
+    PERIOD_OTHER        /**< looks like no key */
+};
+
+/** Score every key length from 1 to `max_period` by coincidence autocorrelation of the
+  * ciphertext's letters. `max_period` may be in the thousands: each shift compares a
+  * bounded sample of letter pairs with vector instructions, so long inputs stay fast.
+  *
+  * \param ranked Receives `max_period` entries, most likely first, grouped by tier and
+  *        ordered within each tier by `bound`, so that long key lengths, which are scored
+  *        from few pairs, do not rank high by chance.
+  * \return The estimated key length, which is the shortest period that scores like English
+  *         rather than the top-ranked one (multiples of the key length score as well), or
+  *         -1 if memory allocation fails.
+  */
+int rank_periods(const char * cipher_text, int max_period, period_score * ranked);
+
+/** Estimate the key length (1 to `max_period`) as `rank_periods` does, then solve each key
+  * letter as a Caesar cipher on its column by chi-square against English. Linear in the
+  * length of the ciphertext.
+  *
+  * Takes the same arguments as `find_best_key_brute_force`, except that `best_key` must
+  * hold at least max_period + 1 bytes; `stats->candidates` counts the (column, letter)
+  * pairs scored, and the candidate budget and `top` are ignored.
+  *
+  * \return 0 on success, -1 if memory allocation fails.
+  */
+int find_best_key_columns(const char * cipher_text, int max_period, char * best_key,
+                          char * best_plain_text, vigenere_crack_stats * stats);
+
+#endif